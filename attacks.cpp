@@ -0,0 +1,326 @@
+#include "attacks.h"
+#include <bit>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define HAVE_X86_PEXT 1
+#endif
+
+Magic rookMagics[64];
+Magic bishopMagics[64];
+uint64_t betweenTable[64][64];
+uint64_t lineTable[64][64];
+
+namespace {
+
+// Shared attack tables. Each square owns a slice of 2^(relevant bits) entries.
+uint64_t rookTable[0x19000];
+uint64_t bishopTable[0x1480];
+
+// The same slices, indexed by PEXT of the occupancy with the square's mask.
+// Only filled in when the CPU supports it.
+uint64_t rookPextTable[0x19000];
+uint64_t bishopPextTable[0x1480];
+
+bool fastPext = false;
+bool hasAVX2 = false;
+SliderBackend backend = SliderBackend::MAGIC;
+
+const int ROOK_DIRECTIONS[4][2] = { {1, 0}, {-1, 0}, {0, 1}, {0, -1} };
+const int BISHOP_DIRECTIONS[4][2] = { {1, 1}, {1, -1}, {-1, 1}, {-1, -1} };
+
+// Magic multipliers found offline with a sparse random search. Any set
+// that maps every relevant occupancy without destructive collisions works.
+const uint64_t ROOK_MAGICS[64] = {
+    0x1080004008801020ULL, 0x0840092002C03000ULL, 0x1900200010400900ULL, 0x0880100008000480ULL,
+    0x4200100420080200ULL, 0x8100020100080400ULL, 0x0200040110886200ULL, 0x0200008040220411ULL,
+    0x0404800084400220ULL, 0x0000401000402000ULL, 0x0086001081220440ULL, 0x0408800800100280ULL,
+    0x000A001201040820ULL, 0x8848800200840080ULL, 0x4001000100040200ULL, 0x0442000102105084ULL,
+    0x9080010020804100ULL, 0x0040404000201009ULL, 0x0000808010002009ULL, 0x2200090021D00100ULL,
+    0x0008008008040080ULL, 0x0004004002010040ULL, 0x0011040008015042ULL, 0x00000A0001768104ULL,
+    0x0000800080204009ULL, 0x2010004140002001ULL, 0x9800200280100080ULL, 0x1000100080080080ULL,
+    0x0442000A00049020ULL, 0x2100040080020080ULL, 0x0800120400900148ULL, 0x0010040A00128541ULL,
+    0x2800804000800030ULL, 0x1010002000400041ULL, 0x4000200011004100ULL, 0x0610008410800800ULL,
+    0x0400802402800800ULL, 0xC100020080800400ULL, 0x0002000802000401ULL, 0x0182085882000401ULL,
+    0x0220204000808000ULL, 0x2860100040024022ULL, 0x0001002004110040ULL, 0x99101042000A0020ULL,
+    0x0004080004008080ULL, 0x0010040002008080ULL, 0x2012004881020004ULL, 0x8300842444820011ULL,
+    0x0088403882010200ULL, 0x0820400080210100ULL, 0x0110910040A00300ULL, 0x0801100280080480ULL,
+    0x0242009008200600ULL, 0x1002000489500200ULL, 0x0040800200010080ULL, 0x0091800041000080ULL,
+    0x0000209300488001ULL, 0x04C1002414824001ULL, 0x020020000B001041ULL, 0x7000100004200901ULL,
+    0x8002002004100802ULL, 0x30010002084C0007ULL, 0x0888221800813004ULL, 0x4000002840840112ULL
+};
+
+const uint64_t BISHOP_MAGICS[64] = {
+    0x2048017020910100ULL, 0x0044410424008008ULL, 0x040828A400900000ULL, 0x8002209200022000ULL,
+    0x0002021000540002ULL, 0x0021018840000000ULL, 0x00009E8420204002ULL, 0x00A0920110084480ULL,
+    0x4003062018010110ULL, 0x0221046812004E09ULL, 0x01E11002958912A0ULL, 0x0000044410804000ULL,
+    0x0000821210000080ULL, 0x080201102210A800ULL, 0x0080040411045004ULL, 0x00704A1842021000ULL,
+    0x1005061070322800ULL, 0x0018001010410444ULL, 0x0010000800401420ULL, 0x2204002844000800ULL,
+    0x2052020412022280ULL, 0x000A020101008208ULL, 0x0040400201042000ULL, 0x03E1082040480410ULL,
+    0x1004200004208414ULL, 0x08700400984808C8ULL, 0x0088080004004410ULL, 0x008C0240140100A2ULL,
+    0x0008840001822000ULL, 0x0050088001080100ULL, 0x98140840040A2200ULL, 0x3002020900210110ULL,
+    0x1004040640206000ULL, 0x1090909000840400ULL, 0x9002444810100020ULL, 0x4000020080080080ULL,
+    0x0028020400011010ULL, 0x0290808300020100ULL, 0x8010020882004410ULL, 0x0604010040082C20ULL,
+    0x20040104C0801008ULL, 0x6004208424001050ULL, 0x1002840041000800ULL, 0x0200042018000102ULL,
+    0xA8002000A0821C00ULL, 0x0040080802201910ULL, 0x0222620444000100ULL, 0x0002080041020088ULL,
+    0x1500820110401050ULL, 0x0000492090100080ULL, 0x0900410041100000ULL, 0x0302000420880000ULL,
+    0x0010501202020020ULL, 0x0008200490049040ULL, 0x0462080214A40120ULL, 0x2421310102008100ULL,
+    0x2400420080884060ULL, 0x0800804406184208ULL, 0x0B0080124A084400ULL, 0x082E082300840412ULL,
+    0x6051049040082200ULL, 0xC610211002102101ULL, 0x0000048808010433ULL, 0x0010200804405440ULL
+};
+
+// Relevant occupancy mask: every square on the rays except the board edge,
+// since a blocker on the last square never changes the attack set.
+uint64_t relevantMask(int square, bool isRook) {
+    uint64_t mask = 0;
+    int rank = square / 8, file = square % 8;
+    const int (*directions)[2] = isRook ? ROOK_DIRECTIONS : BISHOP_DIRECTIONS;
+    for (int d = 0; d < 4; ++d) {
+        int r = rank + directions[d][0], f = file + directions[d][1];
+        while (r + directions[d][0] >= 0 && r + directions[d][0] <= 7 &&
+               f + directions[d][1] >= 0 && f + directions[d][1] <= 7) {
+            mask |= 1ULL << (r * 8 + f);
+            r += directions[d][0];
+            f += directions[d][1];
+        }
+    }
+    return mask;
+}
+
+void initMagics(Magic magics[64], uint64_t* table, const uint64_t* magicNumbers, bool isRook) {
+    uint64_t* next = table;
+    for (int square = 0; square < 64; ++square) {
+        Magic& m = magics[square];
+        m.mask = relevantMask(square, isRook);
+        m.magic = magicNumbers[square];
+        m.shift = 64 - std::popcount(m.mask);
+        m.attacks = next;
+
+        // Enumerate every subset of the mask (Carry-Rippler trick).
+        uint64_t subset = 0;
+        do {
+            m.attacks[m.index(subset)] = slidingAttacksSlow(square, subset, isRook);
+            subset = (subset - m.mask) & m.mask;
+        } while (subset);
+
+        next += 1ULL << std::popcount(m.mask);
+    }
+}
+
+#ifdef HAVE_X86_PEXT
+__attribute__((target("bmi2")))
+void initPext(Magic magics[64], uint64_t* table) {
+    for (int square = 0; square < 64; ++square) {
+        Magic& m = magics[square];
+        // Same slice layout as the magic table, so the offsets carry over.
+        m.pextAttacks = table + (m.attacks - magics[0].attacks);
+        uint64_t subset = 0;
+        do {
+            m.pextAttacks[_pext_u64(subset, m.mask)] = m.attacks[m.index(subset)];
+            subset = (subset - m.mask) & m.mask;
+        } while (subset);
+    }
+}
+
+bool detectFastPext() {
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) || !(ebx & bit_BMI2)) return false;
+
+    // Vendor string is spread over EBX, EDX, ECX of leaf 0.
+    __get_cpuid(0, &eax, &ebx, &ecx, &edx);
+    bool amd = ebx == 0x68747541 && edx == 0x69746E65 && ecx == 0x444D4163; // "AuthenticAMD"
+    if (!amd) return true;
+    __get_cpuid(1, &eax, &ebx, &ecx, &edx);
+    unsigned family = ((eax >> 8) & 0xF) + ((eax >> 20) & 0xFF);
+    return family >= 0x19;
+}
+#endif
+
+void initLines() {
+    for (int a = 0; a < 64; ++a) {
+        for (int b = 0; b < 64; ++b) {
+            uint64_t aBit = 1ULL << a, bBit = 1ULL << b;
+            if (a != b && (rookAttacks(a, 0) & bBit)) {
+                lineTable[a][b] = (rookAttacks(a, 0) & rookAttacks(b, 0)) | aBit | bBit;
+                betweenTable[a][b] = rookAttacks(a, bBit) & rookAttacks(b, aBit);
+            } else if (a != b && (bishopAttacks(a, 0) & bBit)) {
+                lineTable[a][b] = (bishopAttacks(a, 0) & bishopAttacks(b, 0)) | aBit | bBit;
+                betweenTable[a][b] = bishopAttacks(a, bBit) & bishopAttacks(b, aBit);
+            }
+        }
+    }
+}
+
+// Builds the tables once at startup, before main() runs.
+struct MagicInitializer {
+    MagicInitializer() {
+        initMagics(rookMagics, rookTable, ROOK_MAGICS, true);
+        initMagics(bishopMagics, bishopTable, BISHOP_MAGICS, false);
+        initLines();
+#ifdef HAVE_X86_PEXT
+        fastPext = detectFastPext();
+        if (fastPext) {
+            initPext(rookMagics, rookPextTable);
+            initPext(bishopMagics, bishopPextTable);
+            setSliderBackend(SliderBackend::PEXT);
+        }
+        hasAVX2 = __builtin_cpu_supports("avx2");
+        // The fill wins on magic lookups but loses to PEXT ones in perft,
+        // where most maps cover only two or three sliders.
+        if (hasAVX2 && !fastPext) sliderAttackMap = sliderFillAVX2;
+#endif
+    }
+} magicInitializer;
+
+} // namespace
+
+SlidingAttacksFn slidingAttacks = slidingAttacksMagic;
+bool pextLookups = false;
+
+bool cpuHasFastPext() { return fastPext; }
+
+uint64_t slidingAttacksMagic(uint64_t sliders, uint64_t occupied, bool isRook) {
+    const Magic* magics = isRook ? rookMagics : bishopMagics;
+    uint64_t attacks = 0;
+    while (sliders) {
+        const Magic& m = magics[std::countr_zero(sliders)];
+        attacks |= m.attacks[m.index(occupied)];
+        sliders &= sliders - 1;
+    }
+    return attacks;
+}
+
+#ifdef HAVE_X86_PEXT
+__attribute__((target("bmi2")))
+uint64_t slidingAttacksPext(uint64_t sliders, uint64_t occupied, bool isRook) {
+    const Magic* magics = isRook ? rookMagics : bishopMagics;
+    uint64_t attacks = 0;
+    while (sliders) {
+        const Magic& m = magics[std::countr_zero(sliders)];
+        attacks |= m.pextAttacks[_pext_u64(occupied, m.mask)];
+        sliders &= sliders - 1;
+    }
+    return attacks;
+}
+#else
+uint64_t slidingAttacksPext(uint64_t sliders, uint64_t occupied, bool isRook) {
+    return slidingAttacksMagic(sliders, occupied, isRook);
+}
+#endif
+
+SliderMapFn sliderAttackMap = sliderMapLookup;
+
+bool cpuHasAVX2() { return hasAVX2; }
+
+uint64_t sliderMapLookup(uint64_t rookLike, uint64_t bishopLike, uint64_t occupied) {
+    return slidingAttacks(rookLike, occupied, true) | slidingAttacks(bishopLike, occupied, false);
+}
+
+namespace {
+
+constexpr uint64_t NOT_A_FILE = ~0x0101010101010101ULL;
+constexpr uint64_t NOT_H_FILE = ~0x8080808080808080ULL;
+
+// One direction of a Kogge-Stone fill: the squares the sliders reach moving
+// Shift steps at a time, stopping on the first occupied square. wrap clears
+// the squares a step would wrap onto from the other edge.
+template <int Shift>
+uint64_t shiftBy(uint64_t bb) {
+    return Shift > 0 ? bb << Shift : bb >> -Shift;
+}
+
+template <int Shift>
+uint64_t occludedFill(uint64_t sliders, uint64_t empty, uint64_t wrap) {
+    empty &= wrap;
+    sliders |= empty & shiftBy<Shift>(sliders);
+    empty &= shiftBy<Shift>(empty);
+    sliders |= empty & shiftBy<Shift * 2>(sliders);
+    empty &= shiftBy<Shift * 2>(empty);
+    sliders |= empty & shiftBy<Shift * 4>(sliders);
+    return shiftBy<Shift>(sliders) & wrap;
+}
+
+} // namespace
+
+uint64_t sliderFillScalar(uint64_t rookLike, uint64_t bishopLike, uint64_t occupied) {
+    uint64_t empty = ~occupied;
+    return occludedFill<8>(rookLike, empty, ~0ULL) | occludedFill<-8>(rookLike, empty, ~0ULL) |
+           occludedFill<1>(rookLike, empty, NOT_A_FILE) | occludedFill<-1>(rookLike, empty, NOT_H_FILE) |
+           occludedFill<9>(bishopLike, empty, NOT_A_FILE) | occludedFill<7>(bishopLike, empty, NOT_H_FILE) |
+           occludedFill<-7>(bishopLike, empty, NOT_A_FILE) | occludedFill<-9>(bishopLike, empty, NOT_H_FILE);
+}
+
+#ifdef HAVE_X86_PEXT
+namespace {
+
+// Each lane shifts one way only: a shift count of 64 or more gives zero, so
+// the count for the unused way switches that shift off.
+__attribute__((target("avx2")))
+inline __m256i shiftLanes(__m256i bb, __m256i left, __m256i right) {
+    return _mm256_or_si256(_mm256_sllv_epi64(bb, left), _mm256_srlv_epi64(bb, right));
+}
+
+__attribute__((target("avx2")))
+inline __m256i occludedFill4(uint64_t sliders, uint64_t occupied, __m256i left, __m256i right, __m256i wrap) {
+    __m256i gen = _mm256_set1_epi64x(static_cast<int64_t>(sliders));
+    __m256i pro = _mm256_andnot_si256(_mm256_set1_epi64x(static_cast<int64_t>(occupied)), wrap);
+    __m256i stepLeft = left, stepRight = right;
+    for (int i = 0; i < 3; ++i) {
+        gen = _mm256_or_si256(gen, _mm256_and_si256(pro, shiftLanes(gen, stepLeft, stepRight)));
+        pro = _mm256_and_si256(pro, shiftLanes(pro, stepLeft, stepRight));
+        stepLeft = _mm256_add_epi64(stepLeft, stepLeft);
+        stepRight = _mm256_add_epi64(stepRight, stepRight);
+    }
+    return _mm256_and_si256(shiftLanes(gen, left, right), wrap);
+}
+
+} // namespace
+
+// Rook lanes hold north, east, south and west; bishop lanes north-east,
+// north-west, south-east and south-west.
+__attribute__((target("avx2")))
+uint64_t sliderFillAVX2(uint64_t rookLike, uint64_t bishopLike, uint64_t occupied) {
+    const int64_t notA = static_cast<int64_t>(NOT_A_FILE), notH = static_cast<int64_t>(NOT_H_FILE);
+    __m256i rooks = occludedFill4(rookLike, occupied,
+                                  _mm256_setr_epi64x(8, 1, 64, 64), _mm256_setr_epi64x(64, 64, 8, 1),
+                                  _mm256_setr_epi64x(-1, notA, -1, notH));
+    __m256i bishops = occludedFill4(bishopLike, occupied,
+                                    _mm256_setr_epi64x(9, 7, 64, 64), _mm256_setr_epi64x(64, 64, 7, 9),
+                                    _mm256_setr_epi64x(notA, notH, notA, notH));
+    __m256i attacks = _mm256_or_si256(rooks, bishops);
+    __m128i half = _mm_or_si128(_mm256_castsi256_si128(attacks), _mm256_extracti128_si256(attacks, 1));
+    return static_cast<uint64_t>(_mm_cvtsi128_si64(half) | _mm_extract_epi64(half, 1));
+}
+#else
+uint64_t sliderFillAVX2(uint64_t rookLike, uint64_t bishopLike, uint64_t occupied) {
+    return sliderFillScalar(rookLike, bishopLike, occupied);
+}
+#endif
+
+SliderBackend sliderBackend() { return backend; }
+
+bool setSliderBackend(SliderBackend requested) {
+    if (requested == SliderBackend::PEXT && !fastPext) return false;
+    backend = requested;
+    pextLookups = requested == SliderBackend::PEXT;
+    slidingAttacks = requested == SliderBackend::PEXT ? slidingAttacksPext : slidingAttacksMagic;
+    return true;
+}
+
+uint64_t slidingAttacksSlow(int square, uint64_t occupied, bool isRook) {
+    uint64_t attacks = 0;
+    int rank = square / 8, file = square % 8;
+    const int (*directions)[2] = isRook ? ROOK_DIRECTIONS : BISHOP_DIRECTIONS;
+    for (int d = 0; d < 4; ++d) {
+        int r = rank + directions[d][0], f = file + directions[d][1];
+        while (r >= 0 && r <= 7 && f >= 0 && f <= 7) {
+            uint64_t bit = 1ULL << (r * 8 + f);
+            attacks |= bit;
+            if (occupied & bit) break;
+            r += directions[d][0];
+            f += directions[d][1];
+        }
+    }
+    return attacks;
+}
@@ -0,0 +1,155 @@
+#ifndef ATTACKS_H
+#define ATTACKS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace detail {
+
+// Builds a 64-entry table by applying each (rank, file) offset to every square.
+template <std::size_t N>
+constexpr std::array<uint64_t, 64> buildLeaperTable(const int (&offsets)[N][2]) {
+    std::array<uint64_t, 64> table{};
+    for (int square = 0; square < 64; ++square) {
+        int rank = square / 8, file = square % 8;
+        for (const auto& offset : offsets) {
+            int r = rank + offset[0], f = file + offset[1];
+            if (r >= 0 && r <= 7 && f >= 0 && f <= 7) table[square] |= 1ULL << (r * 8 + f);
+        }
+    }
+    return table;
+}
+
+constexpr int KNIGHT_OFFSETS[8][2] = { {2, 1}, {2, -1}, {-2, 1}, {-2, -1}, {1, 2}, {1, -2}, {-1, 2}, {-1, -2} };
+constexpr int KING_OFFSETS[8][2] = { {1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1} };
+constexpr int WHITE_PAWN_OFFSETS[2][2] = { {1, -1}, {1, 1} };
+constexpr int BLACK_PAWN_OFFSETS[2][2] = { {-1, -1}, {-1, 1} };
+
+} // namespace detail
+
+// Leaper attack tables indexed by square, built at compile time.
+inline constexpr std::array<uint64_t, 64> KNIGHT_ATTACKS = detail::buildLeaperTable(detail::KNIGHT_OFFSETS);
+inline constexpr std::array<uint64_t, 64> KING_ATTACKS = detail::buildLeaperTable(detail::KING_OFFSETS);
+
+// Pawn capture targets indexed by [color][square], where color 0 is white and 1 is black.
+inline constexpr std::array<std::array<uint64_t, 64>, 2> PAWN_ATTACKS = {
+    detail::buildLeaperTable(detail::WHITE_PAWN_OFFSETS),
+    detail::buildLeaperTable(detail::BLACK_PAWN_OFFSETS)
+};
+
+// Magic bitboard entry for a single square. The relevant occupancy bits
+// (mask) are multiplied by the magic number and shifted down to form an
+// index into the shared attack table for that piece type. pextAttacks is
+// the same slice of the table indexed by PEXT instead, and stays null on
+// CPUs without a fast PEXT.
+struct Magic {
+    uint64_t mask;
+    uint64_t magic;
+    uint64_t* attacks;
+    uint64_t* pextAttacks;
+    unsigned shift;
+
+    unsigned index(uint64_t occupied) const {
+        return static_cast<unsigned>(((occupied & mask) * magic) >> shift);
+    }
+};
+
+extern Magic rookMagics[64];
+extern Magic bishopMagics[64];
+
+// True while the PEXT backend is selected. The per-square lookups test it
+// inline, since a call through a pointer would cost more than PEXT saves.
+extern bool pextLookups;
+
+namespace detail {
+
+// PEXT written as assembly so callers need not be compiled for BMI2. Only
+// reached when pextLookups is set; volatile stops the compiler from
+// hoisting it above that check onto CPUs that lack the instruction.
+inline uint64_t pext(uint64_t bits, uint64_t mask) {
+#if defined(__x86_64__)
+    uint64_t result;
+    asm volatile("pextq %2, %1, %0" : "=r"(result) : "r"(bits), "r"(mask));
+    return result;
+#else
+    (void)bits, (void)mask;
+    return 0;
+#endif
+}
+
+inline uint64_t sliderLookup(const Magic& m, uint64_t occupied) {
+    return pextLookups ? m.pextAttacks[pext(occupied, m.mask)] : m.attacks[m.index(occupied)];
+}
+
+} // namespace detail
+
+// Returns the squares attacked by a rook on the given square index.
+inline uint64_t rookAttacks(int square, uint64_t occupied) {
+    return detail::sliderLookup(rookMagics[square], occupied);
+}
+
+// Returns the squares attacked by a bishop on the given square index.
+inline uint64_t bishopAttacks(int square, uint64_t occupied) {
+    return detail::sliderLookup(bishopMagics[square], occupied);
+}
+
+// Returns the squares attacked by a queen on the given square index.
+inline uint64_t queenAttacks(int square, uint64_t occupied) {
+    return rookAttacks(square, occupied) | bishopAttacks(square, occupied);
+}
+
+// Backends for every slider lookup, per square above and in bulk below.
+// PEXT indexes a second set of tables with the BMI2 bit-extract instruction
+// instead of a magic multiply.
+enum class SliderBackend { MAGIC, PEXT };
+
+// True if the CPU has BMI2 and a fast PEXT. AMD before Zen 3 implements
+// PEXT in microcode, so it reports false there.
+bool cpuHasFastPext();
+
+// Union of the attacks of every rook (or bishop) in sliders. Goes through
+// the backend picked at startup, so it costs one indirect call per set of
+// sliders rather than per square.
+using SlidingAttacksFn = uint64_t (*)(uint64_t sliders, uint64_t occupied, bool isRook);
+extern SlidingAttacksFn slidingAttacks;
+
+uint64_t slidingAttacksMagic(uint64_t sliders, uint64_t occupied, bool isRook);
+// Only callable when cpuHasFastPext() is true.
+uint64_t slidingAttacksPext(uint64_t sliders, uint64_t occupied, bool isRook);
+
+SliderBackend sliderBackend();
+// Overrides the startup choice, e.g. for benchmarks. Returns false, leaving
+// the backend unchanged, if PEXT is requested on a CPU without it.
+bool setSliderBackend(SliderBackend backend);
+
+// Attacks of every rook-like piece along ranks and files together with every
+// bishop-like piece along diagonals, for attack maps where the per-piece
+// attacks are not needed. With a fast PEXT this is two slidingAttacks calls;
+// failing that, with AVX2 it is a Kogge-Stone occluded fill over the whole
+// sets, and otherwise the magic lookups, which beat the scalar fill.
+using SliderMapFn = uint64_t (*)(uint64_t rookLike, uint64_t bishopLike, uint64_t occupied);
+extern SliderMapFn sliderAttackMap;
+
+uint64_t sliderMapLookup(uint64_t rookLike, uint64_t bishopLike, uint64_t occupied);
+uint64_t sliderFillScalar(uint64_t rookLike, uint64_t bishopLike, uint64_t occupied);
+// Fills the four directions of each slider type in one AVX2 register. Only
+// callable when cpuHasAVX2() is true.
+uint64_t sliderFillAVX2(uint64_t rookLike, uint64_t bishopLike, uint64_t occupied);
+
+bool cpuHasAVX2();
+
+extern uint64_t betweenTable[64][64];
+extern uint64_t lineTable[64][64];
+
+// Squares strictly between two squares on a shared rank, file or diagonal;
+// zero if they are not aligned.
+inline uint64_t betweenBB(int from, int to) { return betweenTable[from][to]; }
+
+// The whole rank, file or diagonal through two aligned squares; zero otherwise.
+inline uint64_t lineBB(int from, int to) { return lineTable[from][to]; }
+
+// Reference ray-walking implementation used to build the magic tables.
+uint64_t slidingAttacksSlow(int square, uint64_t occupied, bool isRook);
+
+#endif // ATTACKS_H
@@ -0,0 +1,106 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include "attacks.h"
+
+// Times the bulk slider lookup of each backend on the same random inputs
+// and reports which one the startup dispatch picked, then does the same for
+// whole-set attack maps built by lookups against the Kogge-Stone fills.
+//   bazel run -c opt //:attacks_bench
+
+struct Sample {
+    uint64_t sliders;
+    uint64_t occupied;
+    // A split of sliders into rook-like and bishop-like pieces, queens in both.
+    uint64_t rookLike;
+    uint64_t bishopLike;
+};
+
+static const char* backendName(SliderBackend backend) {
+    return backend == SliderBackend::PEXT ? "pext" : "magic";
+}
+
+// Nanoseconds per call over every sample, both piece types, repeated.
+static double timeBackend(SlidingAttacksFn fn, const std::vector<Sample>& samples, uint64_t& checksum) {
+    const int ROUNDS = 200;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < ROUNDS; ++round) {
+        for (const Sample& sample : samples) {
+            checksum += fn(sample.sliders, sample.occupied, true);
+            checksum += fn(sample.sliders, sample.occupied, false);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return seconds * 1e9 / (ROUNDS * samples.size() * 2.0);
+}
+
+// Nanoseconds per whole-set attack map.
+static double timeMap(SliderMapFn fn, const std::vector<Sample>& samples, uint64_t& checksum) {
+    const int ROUNDS = 200;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < ROUNDS; ++round) {
+        for (const Sample& sample : samples) {
+            checksum += fn(sample.rookLike, sample.bishopLike, sample.occupied);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return seconds * 1e9 / (ROUNDS * samples.size());
+}
+
+static void compareMaps(const std::vector<Sample>& samples) {
+    uint64_t lookupSum = 0, scalarSum = 0;
+    std::cout << "attack map, " << backendName(sliderBackend()) << " lookups: "
+              << timeMap(sliderMapLookup, samples, lookupSum) << " ns/map" << std::endl;
+    std::cout << "attack map, scalar fill:   " << timeMap(sliderFillScalar, samples, scalarSum) << " ns/map" << std::endl;
+    if (cpuHasAVX2()) {
+        uint64_t avxSum = 0;
+        std::cout << "attack map, avx2 fill:     " << timeMap(sliderFillAVX2, samples, avxSum) << " ns/map" << std::endl;
+        if (avxSum != lookupSum) std::cout << "MISMATCH: the avx2 fill disagrees" << std::endl;
+    }
+    if (scalarSum != lookupSum) std::cout << "MISMATCH: the scalar fill disagrees" << std::endl;
+}
+
+int main() {
+    SliderBackend picked = sliderBackend();
+    std::cout << "fast pext: " << (cpuHasFastPext() ? "yes" : "no") << std::endl;
+    std::cout << "dispatch picked: " << backendName(picked) << std::endl;
+    std::cout << "attack maps use: " << (sliderAttackMap == sliderFillAVX2 ? "avx2 fill" : "lookups") << std::endl;
+
+    // Middlegame-like inputs: about 24 occupied squares and three sliders.
+    std::vector<Sample> samples(4096);
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    auto next = [&state]() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    };
+    for (Sample& sample : samples) {
+        uint64_t occupied = next() & next();
+        occupied |= next() & next() & next();
+        uint64_t sliders = 0;
+        for (int i = 0; i < 3; ++i) sliders |= 1ULL << (next() & 63);
+        uint64_t queens = sliders & next();
+        uint64_t rooks = sliders & next();
+        sample = {sliders, occupied | sliders, rooks | queens, (sliders & ~rooks) | queens};
+    }
+
+    uint64_t magicSum = 0;
+    double magicTime = timeBackend(slidingAttacksMagic, samples, magicSum);
+    std::cout << "magic: " << magicTime << " ns/call" << std::endl;
+    if (cpuHasFastPext()) {
+        uint64_t pextSum = 0;
+        double pextTime = timeBackend(slidingAttacksPext, samples, pextSum);
+        std::cout << "pext:  " << pextTime << " ns/call" << std::endl;
+        if (pextSum != magicSum) {
+            std::cout << "MISMATCH: the backends disagree" << std::endl;
+            return 1;
+        }
+        SliderBackend fastest = pextTime < magicTime ? SliderBackend::PEXT : SliderBackend::MAGIC;
+        std::cout << "fastest: " << backendName(fastest) << std::endl;
+    }
+
+    compareMaps(samples);
+    return 0;
+}
@@ -1,8 +1,14 @@
 #include "board.h"
+#include "attacks.h"
+#include <algorithm>
 #include <iostream>
+#include <iterator>
 #include <stdexcept>
 #include <cmath>
 #include <vector>
+#include <cassert>
+#include <charconv>
+#include <bit>
 
 // Helper function to get the index (0-63) from a single-bit bitboard
 inline uint8_t getSquareIndex(uint64_t bitboard) {
@@ -10,6 +16,10 @@ inline uint8_t getSquareIndex(uint64_t bitboard) {
     return __builtin_ctzll(bitboard);
 }
 
+// Indices into Board::pieces, matching the Color and PieceType enums.
+constexpr int WHITE = 0, BLACK = 1;
+constexpr int QUEEN = 0, ROOK = 1, KNIGHT = 2, BISHOP = 3, PAWN = 4, KING = 5;
+
 // Converts a Square enum value to its algebraic notation string.
 std::string toAlgebraicNotation(Square square) {
     uint64_t square_bitboard = static_cast<uint64_t>(square);
@@ -24,17 +34,59 @@ std::string toAlgebraicNotation(Square square) {
     return std::string(1, file_char) + std::string(1, rank_char);
 }
 
+std::string toUCINotation(PackedMove move) {
+    std::string uci = {
+        static_cast<char>('a' + (move.from() & 7)), static_cast<char>('1' + (move.from() >> 3)),
+        static_cast<char>('a' + (move.to() & 7)), static_cast<char>('1' + (move.to() >> 3))
+    };
+    if (move.kind() == PackedMove::PROMOTION) uci += "qrnb"[static_cast<int>(move.promotionPiece())];
+    return uci;
+}
+
 // Bitboard masks for ranks for efficient checking
+const uint64_t RANK_1 = 0x00000000000000FFULL;
 const uint64_t RANK_2 = 0x000000000000FF00ULL;
 const uint64_t RANK_4 = 0x00000000FF000000ULL;
 const uint64_t RANK_5 = 0x000000FF00000000ULL;
 const uint64_t RANK_7 = 0x00FF000000000000ULL;
+const uint64_t RANK_8 = 0xFF00000000000000ULL;
 
 // Bitboard masks for castling paths
 const uint64_t WHITE_KINGSIDE_CASTLE_PATH = 112ULL;
 const uint64_t WHITE_QUEENSIDE_CASTLE_PATH = 14ULL;
 const uint64_t BLACK_KINGSIDE_CASTLE_PATH = 8070450532247928832ULL;
-const uint64_t BLACK_QUEENSIDE_CASTLE_PATH = 2017612633061982208ULL;
+const uint64_t BLACK_QUEENSIDE_CASTLE_PATH = 1008806316530991104ULL;
+
+// Squares the king starts on, passes through and lands on while castling;
+// none of them may be attacked.
+const uint64_t WHITE_KINGSIDE_CASTLE_SAFE = 0x0000000000000070ULL;
+const uint64_t WHITE_QUEENSIDE_CASTLE_SAFE = 0x000000000000001CULL;
+const uint64_t BLACK_KINGSIDE_CASTLE_SAFE = 0x7000000000000000ULL;
+const uint64_t BLACK_QUEENSIDE_CASTLE_SAFE = 0x1C00000000000000ULL;
+
+// Per-side constants, so color-specialized code folds them at compile time.
+template <Color Us>
+struct Side {
+    static constexpr bool white = Us == Color::WHITE;
+    static constexpr Color them = white ? Color::BLACK : Color::WHITE;
+    static constexpr int us = white ? 0 : 1;
+    static constexpr int forward = white ? 8 : -8;
+    static constexpr uint64_t doublePushFrom = white ? RANK_2 : RANK_7;
+    static constexpr uint64_t doublePushTo = white ? RANK_4 : RANK_5;
+    static constexpr uint64_t promotionRank = white ? 0xFF00000000000000ULL : 0x00000000000000FFULL;
+    static constexpr int kingHome = white ? 4 : 60;
+    static constexpr uint64_t kingsidePath = white ? WHITE_KINGSIDE_CASTLE_PATH : BLACK_KINGSIDE_CASTLE_PATH;
+    static constexpr uint64_t queensidePath = white ? WHITE_QUEENSIDE_CASTLE_PATH : BLACK_QUEENSIDE_CASTLE_PATH;
+    static constexpr uint64_t kingsideSafe = white ? WHITE_KINGSIDE_CASTLE_SAFE : BLACK_KINGSIDE_CASTLE_SAFE;
+    static constexpr uint64_t queensideSafe = white ? WHITE_QUEENSIDE_CASTLE_SAFE : BLACK_QUEENSIDE_CASTLE_SAFE;
+    static constexpr const char* name = white ? "white" : "black";
+
+    // Moves a bitboard one rank towards this side's promotion rank.
+    static constexpr uint64_t push(uint64_t bitboard) {
+        if constexpr (white) return bitboard << 8;
+        else return bitboard >> 8;
+    }
+};
 
 // Precomputed file masks
 const uint64_t file_masks[8] = {
@@ -48,47 +100,103 @@ const uint64_t file_masks[8] = {
     0x8080808080808080ULL  // File H
 };
 
+// Zobrist keys: one per (color, piece, square), one per castling right,
+// one per en-passant file and one for black to move.
+struct ZobristKeys {
+    uint64_t pieces[2][6][64];
+    uint64_t castling[4];
+    uint64_t enPassentFile[8];
+    uint64_t blackToMove;
+};
+
+constexpr ZobristKeys makeZobristKeys() {
+    ZobristKeys keys{};
+    uint64_t state = 0x2545F4914F6CDD1DULL;
+    // SplitMix64 gives well-distributed keys from a fixed seed.
+    auto next = [&state]() {
+        state += 0x9E3779B97F4A7C15ULL;
+        uint64_t z = state;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    };
+    for (auto& color : keys.pieces)
+        for (auto& piece : color)
+            for (auto& key : piece) key = next();
+    for (auto& key : keys.castling) key = next();
+    for (auto& key : keys.enPassentFile) key = next();
+    keys.blackToMove = next();
+    return keys;
+}
+
+constexpr ZobristKeys ZOBRIST = makeZobristKeys();
+
+inline uint64_t pieceKey(Color color, PieceType piece, uint64_t square) {
+    return ZOBRIST.pieces[static_cast<int>(color)][static_cast<int>(piece)][getSquareIndex(square)];
+}
+
 // Board class implementations
-Board::Board() : blackBishops(0), blackKing(0), blackKnights(0), blackPawns(0), blackQueens(0), blackRooks(0),
-              whiteBishops(0), whiteKing(0), whiteKnights(0), whitePawns(0), whiteQueens(0), whiteRooks(0),
+Board::Board() : pieces{}, colorOccupancy{}, occupancy(0), attackMap{}, attackMapValid{},
               blackCastleKingside(false), blackCastleQueenside(false), whiteCastleKingside(false), whiteCastleQueenside(false),
-              enPassent(0), sideToMove(Color::WHITE) {}
+              verbose(false), legacyMoveGeneration(false), enPassent(0), sideToMove(Color::WHITE),
+              halfmoveClock(0), fullmoveNumber(1), hashKey(0), gamePly(0) {
+    std::fill(std::begin(pieceAt), std::end(pieceAt), Piece::NO_PIECE);
+}
 
 Board::Board(const Board& other) = default;
-
-void Board::setBlackBishops(uint64_t squares) { this->blackBishops = squares; }
-void Board::setBlackKing(uint64_t square) { this->blackKing = square; }
-void Board::setBlackKnights(uint64_t squares) { this->blackKnights = squares; }
-void Board::setBlackPawns(uint64_t squares) { this->blackPawns = squares; }
-void Board::setBlackQueens(uint64_t squares) { this->blackQueens = squares; }
-void Board::setBlackRooks(uint64_t squares) { this->blackRooks = squares; }
-void Board::setWhiteBishops(uint64_t squares) { this->whiteBishops = squares; }
-void Board::setWhiteKing(uint64_t square) { this->whiteKing = square; }
-void Board::setWhiteKnights(uint64_t squares) { this->whiteKnights = squares; }
-void Board::setWhitePawns(uint64_t squares) { this->whitePawns = squares; }
-void Board::setWhiteQueens(uint64_t squares) { this->whiteQueens = squares; }
-void Board::setWhiteRooks(uint64_t squares) { this->whiteRooks = squares; }
-void Board::setBlackCastleKingside(bool canCastle) { this->blackCastleKingside = canCastle; }
-void Board::setBlackCastleQueenside(bool canCastle) { this->blackCastleQueenside = canCastle; }
-void Board::setWhiteCastleKingside(bool canCastle) { this->whiteCastleKingside = canCastle; }
-void Board::setWhiteCastleQueenside(bool canCastle) { this->whiteCastleQueenside = canCastle; }
-void Board::setEnPassent(uint64_t square) { this->enPassent = square; }
-void Board::setSideToMove(Color sideToMove) { this->sideToMove = sideToMove; }
+Board& Board::operator=(const Board& other) = default;
+
+void Board::setBlackBishops(uint64_t squares) { setPieces(Color::BLACK, PieceType::BISHOP, squares); }
+void Board::setBlackKing(uint64_t square) { setPieces(Color::BLACK, PieceType::KING, square); }
+void Board::setBlackKnights(uint64_t squares) { setPieces(Color::BLACK, PieceType::KNIGHT, squares); }
+void Board::setBlackPawns(uint64_t squares) { setPieces(Color::BLACK, PieceType::PAWN, squares); }
+void Board::setBlackQueens(uint64_t squares) { setPieces(Color::BLACK, PieceType::QUEEN, squares); }
+void Board::setBlackRooks(uint64_t squares) { setPieces(Color::BLACK, PieceType::ROOK, squares); }
+void Board::setWhiteBishops(uint64_t squares) { setPieces(Color::WHITE, PieceType::BISHOP, squares); }
+void Board::setWhiteKing(uint64_t square) { setPieces(Color::WHITE, PieceType::KING, square); }
+void Board::setWhiteKnights(uint64_t squares) { setPieces(Color::WHITE, PieceType::KNIGHT, squares); }
+void Board::setWhitePawns(uint64_t squares) { setPieces(Color::WHITE, PieceType::PAWN, squares); }
+void Board::setWhiteQueens(uint64_t squares) { setPieces(Color::WHITE, PieceType::QUEEN, squares); }
+void Board::setWhiteRooks(uint64_t squares) { setPieces(Color::WHITE, PieceType::ROOK, squares); }
+// The setters below keep the Zobrist key in step with what they change.
+void Board::setBlackCastleKingside(bool canCastle) {
+    if (blackCastleKingside != canCastle) hashKey ^= ZOBRIST.castling[2];
+    this->blackCastleKingside = canCastle;
+}
+void Board::setBlackCastleQueenside(bool canCastle) {
+    if (blackCastleQueenside != canCastle) hashKey ^= ZOBRIST.castling[3];
+    this->blackCastleQueenside = canCastle;
+}
+void Board::setWhiteCastleKingside(bool canCastle) {
+    if (whiteCastleKingside != canCastle) hashKey ^= ZOBRIST.castling[0];
+    this->whiteCastleKingside = canCastle;
+}
+void Board::setWhiteCastleQueenside(bool canCastle) {
+    if (whiteCastleQueenside != canCastle) hashKey ^= ZOBRIST.castling[1];
+    this->whiteCastleQueenside = canCastle;
+}
+void Board::setEnPassent(uint64_t square) { updateEnPassent(square); }
+void Board::setSideToMove(Color sideToMove) {
+    if (this->sideToMove != sideToMove) hashKey ^= ZOBRIST.blackToMove;
+    this->sideToMove = sideToMove;
+}
+void Board::setHalfmoveClock(int halfmoveClock) { this->halfmoveClock = halfmoveClock; }
+void Board::setFullmoveNumber(int fullmoveNumber) { this->fullmoveNumber = fullmoveNumber; }
 
  // Getter methods
-uint64_t Board::getBlackBishops() { return this->blackBishops; }
-uint64_t Board::getBlackKing() { return this->blackKing; }
-uint64_t Board::getBlackKnights() { return this->blackKnights; }
-uint64_t Board::getBlackPawns() { return this->blackPawns; }
-uint64_t Board::getBlackQueens() { return this->blackQueens; }
-uint64_t Board::getBlackRooks() { return this->blackRooks; }
-
-uint64_t Board::getWhiteBishops() { return this->whiteBishops; }
-uint64_t Board::getWhiteKing() { return this->whiteKing; }
-uint64_t Board::getWhiteKnights() { return this->whiteKnights; }
-uint64_t Board::getWhitePawns() { return this->whitePawns; }
-uint64_t Board::getWhiteQueens(){ return this->whiteQueens; } 
-uint64_t Board::getWhiteRooks() { return this->whiteRooks; }
+uint64_t Board::getBlackBishops() { return this->pieces[BLACK][BISHOP]; }
+uint64_t Board::getBlackKing() { return this->pieces[BLACK][KING]; }
+uint64_t Board::getBlackKnights() { return this->pieces[BLACK][KNIGHT]; }
+uint64_t Board::getBlackPawns() { return this->pieces[BLACK][PAWN]; }
+uint64_t Board::getBlackQueens() { return this->pieces[BLACK][QUEEN]; }
+uint64_t Board::getBlackRooks() { return this->pieces[BLACK][ROOK]; }
+
+uint64_t Board::getWhiteBishops() { return this->pieces[WHITE][BISHOP]; }
+uint64_t Board::getWhiteKing() { return this->pieces[WHITE][KING]; }
+uint64_t Board::getWhiteKnights() { return this->pieces[WHITE][KNIGHT]; }
+uint64_t Board::getWhitePawns() { return this->pieces[WHITE][PAWN]; }
+uint64_t Board::getWhiteQueens(){ return this->pieces[WHITE][QUEEN]; } 
+uint64_t Board::getWhiteRooks() { return this->pieces[WHITE][ROOK]; }
 
 bool Board::getBlackCastleKingside() { return this->blackCastleKingside; }
 bool Board::getBlackCastleQueenside() { return this->blackCastleQueenside; }
@@ -99,24 +207,18 @@ uint64_t Board::getEnPassent() { return this->enPassent; }
 
 Color Board::getSideToMove() { return this->sideToMove; }
 
+int Board::getHalfmoveClock() const { return this->halfmoveClock; }
+int Board::getFullmoveNumber() const { return this->fullmoveNumber; }
+
+Piece Board::pieceOn(Square square) const { return pieceAt[getSquareIndex(static_cast<uint64_t>(square))]; }
+Piece Board::pieceOn(int square) const { return pieceAt[square]; }
+
 std::string Board::toString() const {
     std::string result = "";
     for (int rank = 7; rank >= 0; --rank) {
         for (int file = 0; file < 8; ++file) {
-            uint64_t square_bit = 1ULL << (rank * 8 + file);
-            char piece_char = '.';
-            if ((blackRooks & square_bit) != 0) piece_char = 'r';
-            else if ((blackKnights & square_bit) != 0) piece_char = 'n';
-            else if ((blackBishops & square_bit) != 0) piece_char = 'b';
-            else if ((blackQueens & square_bit) != 0) piece_char = 'q';
-            else if ((blackKing & square_bit) != 0) piece_char = 'k';
-            else if ((blackPawns & square_bit) != 0) piece_char = 'p';
-            else if ((whiteRooks & square_bit) != 0) piece_char = 'R';
-            else if ((whiteKnights & square_bit) != 0) piece_char = 'N';
-            else if ((whiteBishops & square_bit) != 0) piece_char = 'B';
-            else if ((whiteQueens & square_bit) != 0) piece_char = 'Q';
-            else if ((whiteKing & square_bit) != 0) piece_char = 'K';
-            else if ((whitePawns & square_bit) != 0) piece_char = 'P';
+            // Characters follow the Piece enum order, with '.' for NO_PIECE.
+            char piece_char = "QRNBPKqrnbpk."[static_cast<int>(pieceAt[rank * 8 + file])];
             result += piece_char;
         }
         result += '\n';
@@ -124,68 +226,185 @@ std::string Board::toString() const {
     return result;
 }
 
-bool Board::applyMove(Move move) {
-    uint64_t start_bit = static_cast<uint64_t>(move.start);
-    uint64_t end_bit = static_cast<uint64_t>(move.end);
-    
-    uint64_t friendlyPieces, enemyPieces, allPieces;
-    if (this->sideToMove == Color::WHITE) {
-        friendlyPieces = whitePawns | whiteKnights | whiteBishops | whiteRooks | whiteQueens | whiteKing;
-        enemyPieces = blackPawns | blackKnights | blackBishops | blackRooks | blackQueens | blackKing;
-    } else {
-        friendlyPieces = blackPawns | blackKnights | blackBishops | blackRooks | blackQueens | blackKing;
-        enemyPieces = whitePawns | whiteKnights | whiteBishops | whiteRooks | whiteQueens | whiteKing;
-    }
-    allPieces = friendlyPieces | enemyPieces;
+std::unique_ptr<Board> Board::fromFEN(std::string_view fen) {
+    auto board = std::make_unique<Board>();
+    if (!board->setFromFEN(fen)) return nullptr;
+    return board;
+}
 
-    // --- Handle Castling Moves First ---
-    if (this->sideToMove == Color::WHITE) {
-        if ((whiteKing & start_bit) && (whiteRooks & static_cast<uint64_t>(Square::H1)) && move.start == Square::E1 && move.end == Square::G1 && this->whiteCastleKingside) {
-            if (areSquaresAttacked(WHITE_KINGSIDE_CASTLE_PATH, Color::BLACK)) {
-                if (verbose) std::cout << "white king castling kingside out of, into, or through check" << std::endl;
-                return false;
-            }
-            if (!((friendlyPieces | enemyPieces) & (WHITE_KINGSIDE_CASTLE_PATH &~whiteKing))) {
-                whiteKing = static_cast<uint64_t>(Square::G1);
-                whiteRooks &= ~static_cast<uint64_t>(Square::H1);
-                whiteRooks |= static_cast<uint64_t>(Square::F1);
-                return true;
-            }
+// Parses a move counter; an absent field keeps the default.
+static bool parseCounter(std::string_view field, int& value) {
+    if (field.empty()) return true;
+    auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+    return error == std::errc() && end == field.data() + field.size() && value >= 0;
+}
+
+bool Board::setFromFEN(std::string_view fen) {
+    // Splits off the next space-separated field, or returns an empty view.
+    auto nextField = [&fen]() {
+        size_t start = fen.find_first_not_of(" \t");
+        if (start == std::string_view::npos) return std::string_view();
+        size_t end = std::min(fen.find_first_of(" \t", start), fen.size());
+        std::string_view field = fen.substr(start, end - start);
+        fen.remove_prefix(end);
+        return field;
+    };
+    std::string_view placement = nextField();
+    std::string_view side = nextField();
+    std::string_view castling = nextField();
+    std::string_view enPassant = nextField();
+    std::string_view halfmove = nextField();
+    std::string_view fullmove = nextField();
+    if (enPassant.empty() || !nextField().empty()) return false;
+
+    // Parsed into locals so a malformed FEN leaves this board untouched.
+    uint64_t placed[2][6] = {};
+    Piece squares[64];
+    std::fill(std::begin(squares), std::end(squares), Piece::NO_PIECE);
+    int rank = 7, file = 0;
+    for (char c : placement) {
+        if (c == '/') {
+            if (file != 8 || rank == 0) return false;
+            --rank;
+            file = 0;
+        } else if (c >= '1' && c <= '8') {
+            file += c - '0';
+            if (file > 8) return false;
+        } else {
+            size_t index = std::string_view("QRNBPKqrnbpk").find(c);
+            if (index == std::string_view::npos || file > 7) return false;
+            Piece piece = static_cast<Piece>(index);
+            placed[static_cast<int>(pieceColorOf(piece))][static_cast<int>(pieceTypeOf(piece))] |= 1ULL << (rank * 8 + file);
+            squares[rank * 8 + file] = piece;
+            ++file;
         }
-        else if ((whiteKing & start_bit) && (whiteRooks & static_cast<uint64_t>(Square::A1)) && move.start == Square::E1 && move.end == Square::C1 && this->whiteCastleQueenside) {
-            if (areSquaresAttacked(WHITE_QUEENSIDE_CASTLE_PATH, Color::BLACK)) {
-                if (verbose) std::cout << "white king castling queenside out of, into, or through check" << std::endl;
-                return false;
-            }
-            if (!((friendlyPieces | enemyPieces) & (WHITE_QUEENSIDE_CASTLE_PATH &~whiteKing))) {
-                whiteKing = static_cast<uint64_t>(Square::C1);
-                whiteRooks &= ~static_cast<uint64_t>(Square::A1);
-                whiteRooks |= static_cast<uint64_t>(Square::D1);
-                return true;
-            }
+    }
+    if (rank != 0 || file != 8) return false;
+    // Move generation relies on each side having one king and on pawns never
+    // standing on the first or last rank, so such positions are rejected.
+    if ((placed[WHITE][PAWN] | placed[BLACK][PAWN]) & (RANK_1 | RANK_8)) return false;
+    if (std::popcount(placed[WHITE][KING]) != 1 || std::popcount(placed[BLACK][KING]) != 1) return false;
+
+    Color color;
+    if (side == "w") color = Color::WHITE;
+    else if (side == "b") color = Color::BLACK;
+    else return false;
+
+    bool castleRights[4] = {}; // K, Q, k, q
+    if (castling != "-") {
+        for (char c : castling) {
+            size_t index = std::string_view("KQkq").find(c);
+            if (index == std::string_view::npos) return false;
+            castleRights[index] = true;
         }
-    } else {
-        if ((blackKing & start_bit) && (blackRooks & static_cast<uint64_t>(Square::H8)) && move.start == Square::E8 && move.end == Square::G8 && this->blackCastleKingside) {
-            if (areSquaresAttacked(BLACK_KINGSIDE_CASTLE_PATH, Color::WHITE)) {
-                if (verbose) std::cout << "black king castling kingside out of, into, or through check" << std::endl;
-                return false;
-            }
-            if (!((friendlyPieces | enemyPieces) & (BLACK_KINGSIDE_CASTLE_PATH &~blackKing))) {
-                blackKing = static_cast<uint64_t>(Square::G8);
-                blackRooks &= ~static_cast<uint64_t>(Square::H8);
-                blackRooks |= static_cast<uint64_t>(Square::F8);
-                return true;
+    }
+
+    uint64_t epSquare = 0;
+    if (enPassant != "-") {
+        char expectedRank = color == Color::WHITE ? '6' : '3';
+        if (enPassant.size() != 2 || enPassant[0] < 'a' || enPassant[0] > 'h' || enPassant[1] != expectedRank) return false;
+        epSquare = 1ULL << ((enPassant[1] - '1') * 8 + (enPassant[0] - 'a'));
+    }
+
+    int halfmoves = 0, fullmoves = 1;
+    if (!parseCounter(halfmove, halfmoves) || !parseCounter(fullmove, fullmoves)) return false;
+
+    // Reset in place rather than assigning a fresh Board, which would
+    // copy the whole key history for every position read.
+    for (int c = 0; c < 2; ++c) {
+        std::copy(std::begin(placed[c]), std::end(placed[c]), std::begin(pieces[c]));
+        colorOccupancy[c] = 0;
+        for (uint64_t bitboard : placed[c]) colorOccupancy[c] |= bitboard;
+    }
+    occupancy = colorOccupancy[WHITE] | colorOccupancy[BLACK];
+    std::copy(std::begin(squares), std::end(squares), std::begin(pieceAt));
+    attackMapValid[WHITE] = attackMapValid[BLACK] = false;
+    whiteCastleKingside = castleRights[0];
+    whiteCastleQueenside = castleRights[1];
+    blackCastleKingside = castleRights[2];
+    blackCastleQueenside = castleRights[3];
+    enPassent = epSquare;
+    sideToMove = color;
+    halfmoveClock = halfmoves;
+    fullmoveNumber = fullmoves == 0 ? 1 : fullmoves;
+    gamePly = 0;
+    hashKey = computeHash();
+    return true;
+}
+
+std::string Board::toFEN() const {
+    std::string fen;
+    fen.reserve(96);
+    for (int rank = 7; rank >= 0; --rank) {
+        int empty = 0;
+        for (int file = 0; file < 8; ++file) {
+            Piece piece = pieceAt[rank * 8 + file];
+            if (piece == Piece::NO_PIECE) {
+                ++empty;
+                continue;
             }
+            if (empty) fen += static_cast<char>('0' + empty);
+            empty = 0;
+            fen += "QRNBPKqrnbpk"[static_cast<int>(piece)];
         }
-        else if ((blackKing & start_bit) && (blackRooks & static_cast<uint64_t>(Square::A8)) && move.start == Square::E8 && move.end == Square::C8 && this->blackCastleQueenside) {
-            if (areSquaresAttacked(BLACK_QUEENSIDE_CASTLE_PATH, Color::WHITE)) {
-                if (verbose) std::cout << "black king castling queenside out of, into, or through check" << std::endl;
+        if (empty) fen += static_cast<char>('0' + empty);
+        if (rank) fen += '/';
+    }
+
+    fen += sideToMove == Color::WHITE ? " w " : " b ";
+    if (whiteCastleKingside) fen += 'K';
+    if (whiteCastleQueenside) fen += 'Q';
+    if (blackCastleKingside) fen += 'k';
+    if (blackCastleQueenside) fen += 'q';
+    if (!(whiteCastleKingside || whiteCastleQueenside || blackCastleKingside || blackCastleQueenside)) fen += '-';
+
+    fen += ' ';
+    if (enPassent) {
+        int square = getSquareIndex(enPassent);
+        fen += static_cast<char>('a' + (square & 7));
+        fen += static_cast<char>('1' + (square >> 3));
+    } else {
+        fen += '-';
+    }
+
+    fen += ' ';
+    fen += std::to_string(halfmoveClock);
+    fen += ' ';
+    fen += std::to_string(fullmoveNumber);
+    return fen;
+}
+
+bool Board::applyMove(PackedMove move) {
+    return sideToMove == Color::WHITE ? applyMove<Color::WHITE>(move) : applyMove<Color::BLACK>(move);
+}
+
+template <Color Us>
+bool Board::applyMove(PackedMove move) {
+    using S = Side<Us>;
+    uint64_t start_bit = 1ULL << move.from();
+    uint64_t end_bit = 1ULL << move.to();
+    uint64_t friendlyPieces = colorOccupancy[S::us];
+    uint64_t enemyPieces = colorOccupancy[S::us ^ 1];
+    uint64_t allPieces = occupancy;
+
+    // --- Handle Castling Moves First ---
+    if (move.kind() == PackedMove::CASTLING && move.from() == S::kingHome && (pieces[S::us][KING] & start_bit)) {
+        bool kingside = move.to() == S::kingHome + 2;
+        bool queenside = move.to() == S::kingHome - 2;
+        bool canCastle = kingside ? (S::white ? whiteCastleKingside : blackCastleKingside)
+                                  : (S::white ? whiteCastleQueenside : blackCastleQueenside);
+        uint64_t rookFrom = 1ULL << (kingside ? S::kingHome + 3 : S::kingHome - 4);
+        uint64_t rookTo = 1ULL << (kingside ? S::kingHome + 1 : S::kingHome - 1);
+        if ((kingside || queenside) && canCastle && (pieces[S::us][ROOK] & rookFrom)) {
+            if (areSquaresAttacked<S::them>(kingside ? S::kingsideSafe : S::queensideSafe)) {
+                if (verbose) std::cout << S::name << " king castling " << (kingside ? "kingside" : "queenside") << " out of, into, or through check" << std::endl;
                 return false;
             }
-            if (!((friendlyPieces | enemyPieces) & (BLACK_QUEENSIDE_CASTLE_PATH &~blackKing))) {
-                blackKing = static_cast<uint64_t>(Square::C8);
-                blackRooks &= ~static_cast<uint64_t>(Square::A8);
-                blackRooks |= static_cast<uint64_t>(Square::D8);
+            if (!(allPieces & ((kingside ? S::kingsidePath : S::queensidePath) & ~start_bit))) {
+                movePiece(Us, PieceType::KING, start_bit, end_bit);
+                movePiece(Us, PieceType::ROOK, rookFrom, rookTo);
+                updateEnPassent(0);
+                updateCastlingRights(start_bit, end_bit);
                 return true;
             }
         }
@@ -200,116 +419,52 @@ bool Board::applyMove(Move move) {
         return false;
     }
 
-    uint8_t start_rank = getSquareIndex(start_bit) >> 3;
-    uint8_t start_file = getSquareIndex(start_bit) & 7;
-    uint8_t end_rank = getSquareIndex(end_bit) >> 3;
-    uint8_t end_file = getSquareIndex(end_bit) & 7;
-    bool isPawnDoubleStep = false;
-    
-    if ((whitePawns & start_bit) || (blackPawns & start_bit)) {
-        if (this->sideToMove == Color::WHITE) {
-            if (end_bit == (start_bit << 8) && (allPieces & end_bit) == 0) {}
-            else if ((start_bit & RANK_2) && (end_bit & RANK_4) && (allPieces & (end_bit | (start_bit << 8))) == 0) {
-                isPawnDoubleStep = true; 
-                this->enPassent = start_bit << 8;
-            }
-            else if ((end_bit == (start_bit << 7) || end_bit == (start_bit << 9)) && (enemyPieces & end_bit)) {}
-            else if (end_bit == this->enPassent) { blackPawns &= ~(end_bit >> 8); }
-            else {
-                if (verbose) std::cout << "white invalid pawn move" << std::endl;
-                return false; 
-            }
-            whitePawns &= ~start_bit;
-
-            // Check for white pawn promotion
-            if ((end_bit & 0xFF00000000000000ULL) != 0) {
-                // Promote to the specified piece type
-                switch (move.promotionPiece) {
-                    case PieceType::QUEEN:
-                        whiteQueens |= end_bit;
-                        break;
-                    case PieceType::ROOK:
-                        whiteRooks |= end_bit;
-                        break;
-                    case PieceType::KNIGHT:
-                        whiteKnights |= end_bit;
-                        break;
-                    case PieceType::BISHOP:
-                        whiteBishops |= end_bit;
-                        break;
-                }
-            } else {
-                // Otherwise, place pawn on new square
-                whitePawns |= end_bit;
-            }
-        } else {
-            if (end_bit == (start_bit >> 8) && (allPieces & end_bit) == 0) {}
-            else if ((start_bit & RANK_7) && (end_bit & RANK_5) && (allPieces & (end_bit | (start_bit >> 8))) == 0) { 
-                isPawnDoubleStep = true;
-                this->enPassent = start_bit >> 8;
-            }
-            else if ((end_bit == (start_bit >> 7) || end_bit == (start_bit >> 9)) && (enemyPieces & end_bit)) {}
-            else if (end_bit == this->enPassent) { whitePawns &= ~(end_bit << 8); }
-            else {
-                if (verbose) std::cout << "black invalid pawn move " << toAlgebraicNotation(static_cast<Square>(start_bit)) << " moving to " <<  toAlgebraicNotation(static_cast<Square>(end_bit)) << std::endl;
-                // if (verbose) std::cout << this->toString() << std::endl;
-                // if (verbose) std::cout << (end_bit == (start_bit >> 7) || end_bit == (start_bit >> 9)) << std::endl;
-                // if (verbose) std::cout << (enemyPieces & end_bit) << std::endl;
-                return false; 
-            }
-            blackPawns &= ~start_bit;
-
-            // Check for black pawn promotion
-            if ((end_bit & 0x00000000000000FFULL) != 0) {
-                // Promote to the specified piece type
-                switch (move.promotionPiece) {
-                    case PieceType::QUEEN:
-                        blackQueens |= end_bit;
-                        break;
-                    case PieceType::ROOK:
-                        blackRooks |= end_bit;
-                        break;
-                    case PieceType::KNIGHT:
-                        blackKnights |= end_bit;
-                        break;
-                    case PieceType::BISHOP:
-                        blackBishops |= end_bit;
-                        break;
-                }
-            } else {
-                // Otherwise, place pawn on new square
-                blackPawns |= end_bit;
-            }
+    uint8_t start_rank = move.from() >> 3;
+    uint8_t start_file = move.from() & 7;
+    uint8_t end_rank = move.to() >> 3;
+    uint8_t end_file = move.to() & 7;
+    uint64_t newEnPassent = 0;
+    uint64_t enPassentCapture = 0;
+    PieceType movingPiece = pieceTypeOf(pieceAt[move.from()]);
+    Piece captured = pieceAt[move.to()];
+
+    // Validate the move for the piece type; nothing is changed until it passes.
+    if (movingPiece == PieceType::PAWN) {
+        if (end_bit == S::push(start_bit) && (allPieces & end_bit) == 0) {}
+        else if ((start_bit & S::doublePushFrom) && (end_bit & S::doublePushTo) && (allPieces & (end_bit | S::push(start_bit))) == 0) {
+            newEnPassent = S::push(start_bit);
+        }
+        else if ((PAWN_ATTACKS[S::us][move.from()] & end_bit) && (enemyPieces & end_bit)) {}
+        else if ((PAWN_ATTACKS[S::us][move.from()] & end_bit) && end_bit == this->enPassent) {
+            enPassentCapture = S::white ? (end_bit >> 8) : (end_bit << 8);
+        }
+        else {
+            if (verbose) std::cout << S::name << " invalid pawn move " << toAlgebraicNotation(static_cast<Square>(start_bit)) << " moving to " <<  toAlgebraicNotation(static_cast<Square>(end_bit)) << std::endl;
+            return false; 
         }
     }
-    else if ((whiteKnights & start_bit) || (blackKnights & start_bit)) {
+    else if (movingPiece == PieceType::KNIGHT) {
         int rank_diff = std::abs(start_rank - end_rank);
         int file_diff = std::abs(start_file - end_file);
         if (!((rank_diff == 2 && file_diff == 1) || (rank_diff == 1 && file_diff == 2))) {
-            if (verbose) std::cout << "white invalid knight move" << std::endl;
+            if (verbose) std::cout << "invalid knight move" << std::endl;
             return false;
         }
-        if (whiteKnights & start_bit) { whiteKnights &= ~start_bit; whiteKnights |= end_bit; }
-        else { blackKnights &= ~start_bit; blackKnights |= end_bit; }
     }
-    else if ((whiteBishops & start_bit) || (blackBishops & start_bit)) {
+    else if (movingPiece == PieceType::BISHOP) {
         if (std::abs(start_rank - end_rank) != std::abs(start_file - end_file) || !isPathClear(start_bit, end_bit, allPieces)) {
-            if (verbose) std::cout << "white invalid bishop move" << std::endl;
+            if (verbose) std::cout << "invalid bishop move" << std::endl;
             return false;
         }
-        if (whiteBishops & start_bit) { whiteBishops &= ~start_bit; whiteBishops |= end_bit; }
-        else { blackBishops &= ~start_bit; blackBishops |= end_bit; }
     }
-    else if ((whiteRooks & start_bit) || (blackRooks & start_bit)) {
+    else if (movingPiece == PieceType::ROOK) {
         bool isStraight = (start_rank == end_rank) || (start_file == end_file);
         if (!isStraight || !isPathClear(start_bit, end_bit, allPieces)) {
-            if (verbose) std::cout << "black invalid knight move" << std::endl;
+            if (verbose) std::cout << "invalid rook move" << std::endl;
             return false;
         }
-        if (whiteRooks & start_bit) { whiteRooks &= ~start_bit; whiteRooks |= end_bit; }
-        else { blackRooks &= ~start_bit; blackRooks |= end_bit; }
     }
-    else if ((whiteQueens & start_bit) || (blackQueens & start_bit)) {
+    else if (movingPiece == PieceType::QUEEN) {
         bool isHorizontal = start_rank == end_rank;
         bool isVertical = start_file == end_file;
         bool isDiagonal = std::abs(start_rank - end_rank) == std::abs(start_file - end_file);
@@ -317,36 +472,250 @@ bool Board::applyMove(Move move) {
             if (verbose) std::cout << "invalid queen move" << std::endl;
             return false;
         }
-        if (whiteQueens & start_bit) { whiteQueens &= ~start_bit; whiteQueens |= end_bit; }
-        else { blackQueens &= ~start_bit; blackQueens |= end_bit; }
     }
-    else if ((whiteKing & start_bit) || (blackKing & start_bit)) {
+    else {
         int rank_diff = std::abs(start_rank - end_rank);
         int file_diff = std::abs(start_file - end_file);
         if (rank_diff > 1 || file_diff > 1) {
             if (verbose) std::cout << "invalid king move" << std::endl;
             return false;
         }
-        if (whiteKing & start_bit) { whiteKing &= ~start_bit; whiteKing |= end_bit; }
-        else { blackKing &= ~start_bit; blackKing |= end_bit; }
-    } else {
-        if (verbose) std::cout << "invalid move, can't detect any piece" << std::endl;
-        return false;
     }
 
-    if (this->sideToMove == Color::WHITE) {
-        blackPawns &= ~end_bit; blackKnights &= ~end_bit; blackBishops &= ~end_bit;
-        blackRooks &= ~end_bit; blackQueens &= ~end_bit; blackKing &= ~end_bit;
+    // Remove any captured piece before the mover lands on its square.
+    if (captured != Piece::NO_PIECE) {
+        removePiece(S::them, pieceTypeOf(captured), end_bit);
+    }
+    if (enPassentCapture) {
+        removePiece(S::them, PieceType::PAWN, enPassentCapture);
+    }
+
+    if (movingPiece == PieceType::PAWN && (end_bit & S::promotionRank)) {
+        // Promote to the specified piece type, defaulting to a queen
+        PieceType promotion = move.promotionPiece();
+        if (promotion == PieceType::PAWN || promotion == PieceType::KING) promotion = PieceType::QUEEN;
+        removePiece(Us, PieceType::PAWN, start_bit);
+        addPiece(Us, promotion, end_bit);
     } else {
-        whitePawns &= ~end_bit; whiteKnights &= ~end_bit; whiteBishops &= ~end_bit;
-        whiteRooks &= ~end_bit; whiteQueens &= ~end_bit; whiteKing &= ~end_bit;
+        movePiece(Us, movingPiece, start_bit, end_bit);
     }
     
-    if (!isPawnDoubleStep) this->enPassent = 0;
+    updateEnPassent(newEnPassent);
+    updateCastlingRights(start_bit, end_bit);
 
     return true;
 }
 
+// Moving the king or a rook off its home square, or capturing a rook there,
+// loses the matching castling right.
+void Board::updateCastlingRights(uint64_t start_bit, uint64_t end_bit) {
+    uint64_t touched = start_bit | end_bit;
+    if (whiteCastleKingside && (touched & (Square::E1 | Square::H1))) {
+        whiteCastleKingside = false;
+        hashKey ^= ZOBRIST.castling[0];
+    }
+    if (whiteCastleQueenside && (touched & (Square::E1 | Square::A1))) {
+        whiteCastleQueenside = false;
+        hashKey ^= ZOBRIST.castling[1];
+    }
+    if (blackCastleKingside && (touched & (Square::E8 | Square::H8))) {
+        blackCastleKingside = false;
+        hashKey ^= ZOBRIST.castling[2];
+    }
+    if (blackCastleQueenside && (touched & (Square::E8 | Square::A8))) {
+        blackCastleQueenside = false;
+        hashKey ^= ZOBRIST.castling[3];
+    }
+}
+
+void Board::updateEnPassent(uint64_t square) {
+    if (enPassent) hashKey ^= ZOBRIST.enPassentFile[getSquareIndex(enPassent) & 7];
+    enPassent = square;
+    if (enPassent) hashKey ^= ZOBRIST.enPassentFile[getSquareIndex(enPassent) & 7];
+}
+
+void Board::addPiece(Color color, PieceType piece, uint64_t square) {
+    pieces[static_cast<int>(color)][static_cast<int>(piece)] |= square;
+    colorOccupancy[static_cast<int>(color)] |= square;
+    occupancy |= square;
+    pieceAt[getSquareIndex(square)] = makePiece(color, piece);
+    hashKey ^= pieceKey(color, piece, square);
+    attackMapValid[WHITE] = attackMapValid[BLACK] = false;
+}
+
+void Board::removePiece(Color color, PieceType piece, uint64_t square) {
+    pieces[static_cast<int>(color)][static_cast<int>(piece)] &= ~square;
+    colorOccupancy[static_cast<int>(color)] &= ~square;
+    occupancy &= ~square;
+    pieceAt[getSquareIndex(square)] = Piece::NO_PIECE;
+    hashKey ^= pieceKey(color, piece, square);
+    attackMapValid[WHITE] = attackMapValid[BLACK] = false;
+}
+
+void Board::movePiece(Color color, PieceType piece, uint64_t from, uint64_t to) {
+    pieces[static_cast<int>(color)][static_cast<int>(piece)] ^= from | to;
+    colorOccupancy[static_cast<int>(color)] ^= from | to;
+    occupancy ^= from | to;
+    pieceAt[getSquareIndex(from)] = Piece::NO_PIECE;
+    pieceAt[getSquareIndex(to)] = makePiece(color, piece);
+    hashKey ^= pieceKey(color, piece, from) ^ pieceKey(color, piece, to);
+    attackMapValid[WHITE] = attackMapValid[BLACK] = false;
+}
+
+uint64_t Board::hash() const { return hashKey; }
+
+uint64_t Board::computeHash() const {
+    uint64_t key = 0;
+    const Color colors[] = { Color::WHITE, Color::BLACK };
+    const PieceType types[] = { PieceType::QUEEN, PieceType::ROOK, PieceType::KNIGHT,
+                                PieceType::BISHOP, PieceType::PAWN, PieceType::KING };
+    for (Color color : colors) {
+        for (PieceType type : types) {
+            uint64_t squares = pieceBitboard(color, type);
+            while (squares) {
+                key ^= pieceKey(color, type, squares & -squares);
+                squares &= squares - 1;
+            }
+        }
+    }
+    if (whiteCastleKingside) key ^= ZOBRIST.castling[0];
+    if (whiteCastleQueenside) key ^= ZOBRIST.castling[1];
+    if (blackCastleKingside) key ^= ZOBRIST.castling[2];
+    if (blackCastleQueenside) key ^= ZOBRIST.castling[3];
+    if (enPassent) key ^= ZOBRIST.enPassentFile[getSquareIndex(enPassent) & 7];
+    if (sideToMove == Color::BLACK) key ^= ZOBRIST.blackToMove;
+    return key;
+}
+
+// Finds which of the given color's pieces stands on the square, if any.
+bool Board::findPiece(Color color, uint64_t square, PieceType& piece) {
+    Piece found = pieceAt[getSquareIndex(square)];
+    if (found == Piece::NO_PIECE || pieceColorOf(found) != color) {
+        return false;
+    }
+    piece = pieceTypeOf(found);
+    return true;
+}
+
+// Replaces all of one piece's squares, keeping the mailbox and occupancy in step.
+void Board::setPieces(Color color, PieceType piece, uint64_t squares) {
+    uint64_t& bitboard = pieces[static_cast<int>(color)][static_cast<int>(piece)];
+    Piece coloredPiece = makePiece(color, piece);
+    for (uint64_t old = bitboard; old; old &= old - 1) {
+        if (pieceAt[getSquareIndex(old)] == coloredPiece) pieceAt[getSquareIndex(old)] = Piece::NO_PIECE;
+    }
+    for (uint64_t changed = bitboard ^ squares; changed; changed &= changed - 1) {
+        hashKey ^= pieceKey(color, piece, changed & -changed);
+    }
+    bitboard = squares;
+    for (uint64_t now = squares; now; now &= now - 1) {
+        pieceAt[getSquareIndex(now)] = coloredPiece;
+    }
+
+    // Setters may overlap other pieces, so rebuild the occupancy from scratch.
+    for (int c = WHITE; c <= BLACK; ++c) {
+        colorOccupancy[c] = 0;
+        for (uint64_t bb : pieces[c]) colorOccupancy[c] |= bb;
+    }
+    occupancy = colorOccupancy[WHITE] | colorOccupancy[BLACK];
+    attackMapValid[WHITE] = attackMapValid[BLACK] = false;
+}
+
+bool Board::doMove(Move move, UndoInfo& undo) {
+    return doMove(encodeMove(move), undo);
+}
+
+bool Board::doMove(PackedMove move, UndoInfo& undo) {
+    uint64_t start_bit = 1ULL << move.from();
+    uint64_t end_bit = 1ULL << move.to();
+    Color opponentColor = (sideToMove == Color::WHITE) ? Color::BLACK : Color::WHITE;
+
+    undo.move = move;
+    if (!findPiece(sideToMove, start_bit, undo.movedPiece)) {
+        if (verbose) std::cout << "no friendly piece on start square: " << toAlgebraicNotation(static_cast<Square>(start_bit)) << std::endl;
+        return false;
+    }
+    undo.isCapture = findPiece(opponentColor, end_bit, undo.capturedPiece);
+    undo.capturedSquare = end_bit;
+    if (!undo.isCapture && undo.movedPiece == PieceType::PAWN && enPassent && end_bit == enPassent) {
+        undo.isCapture = true;
+        undo.capturedPiece = PieceType::PAWN;
+        undo.capturedSquare = (sideToMove == Color::WHITE) ? (end_bit >> 8) : (end_bit << 8);
+    }
+    undo.blackCastleKingside = blackCastleKingside;
+    undo.blackCastleQueenside = blackCastleQueenside;
+    undo.whiteCastleKingside = whiteCastleKingside;
+    undo.whiteCastleQueenside = whiteCastleQueenside;
+    undo.enPassent = enPassent;
+    undo.hash = hashKey;
+    undo.halfmoveClock = halfmoveClock;
+
+    if (!applyMove(move)) {
+        return false;
+    }
+    keyHistory[gamePly++ % KEY_HISTORY_SIZE] = undo.hash;
+    halfmoveClock = (undo.isCapture || undo.movedPiece == PieceType::PAWN) ? 0 : halfmoveClock + 1;
+    if (sideToMove == Color::BLACK) ++fullmoveNumber;
+    sideToMove = opponentColor;
+    hashKey ^= ZOBRIST.blackToMove;
+    assert(hashKey == computeHash());
+    return true;
+}
+
+void Board::undoMove(const UndoInfo& undo) {
+    Color mover = (sideToMove == Color::WHITE) ? Color::BLACK : Color::WHITE;
+    uint64_t start_bit = 1ULL << undo.move.from();
+    uint64_t end_bit = 1ULL << undo.move.to();
+
+    // The piece helpers also touch the hash, but it is restored wholesale below.
+    // Castling moves the rook as well; put it back.
+    if (undo.move.kind() == PackedMove::CASTLING) {
+        bool kingside = undo.move.to() > undo.move.from();
+        uint64_t rookFrom = kingside ? (start_bit << 3) : (start_bit >> 4);
+        uint64_t rookTo = kingside ? (start_bit << 1) : (start_bit >> 1);
+        movePiece(mover, PieceType::ROOK, rookTo, rookFrom);
+    }
+
+    // Clear the destination of whatever now stands there; this also removes a promoted piece.
+    removePiece(mover, pieceTypeOf(pieceAt[undo.move.to()]), end_bit);
+    addPiece(mover, undo.movedPiece, start_bit);
+
+    if (undo.isCapture) {
+        addPiece(sideToMove, undo.capturedPiece, undo.capturedSquare);
+    }
+
+    blackCastleKingside = undo.blackCastleKingside;
+    blackCastleQueenside = undo.blackCastleQueenside;
+    whiteCastleKingside = undo.whiteCastleKingside;
+    whiteCastleQueenside = undo.whiteCastleQueenside;
+    enPassent = undo.enPassent;
+    sideToMove = mover;
+    hashKey = undo.hash;
+    halfmoveClock = undo.halfmoveClock;
+    if (mover == Color::BLACK) --fullmoveNumber;
+    --gamePly;
+}
+
+// Counts earlier occurrences of the current position, stopping at limit.
+// Only positions with the same side to move, and none before the last
+// irreversible move, can match.
+int Board::repetitions(int limit) const {
+    int count = 0;
+    int reach = std::min({halfmoveClock, gamePly, KEY_HISTORY_SIZE / 2});
+    for (int distance = 4; distance <= reach; distance += 2) {
+        if (keyHistory[(gamePly - distance) % KEY_HISTORY_SIZE] == hashKey && ++count == limit) break;
+    }
+    return count;
+}
+
+bool Board::isRepetition() const { return repetitions(1) >= 1; }
+
+bool Board::isThreefoldRepetition() const { return repetitions(2) >= 2; }
+
+bool Board::isFiftyMoveDraw() {
+    return halfmoveClock >= 100 && !isKingInCheckmate(sideToMove);
+}
+
 bool Board::isPathClear(uint64_t start_bit, uint64_t end_bit, uint64_t allPieces) {
     uint8_t start_index = getSquareIndex(start_bit);
     uint8_t end_index = getSquareIndex(end_bit);
@@ -387,88 +756,52 @@ uint64_t Board::getPawnAttacks(Color side, uint64_t pawns) {
 
 uint64_t Board::getKnightAttacks(uint64_t knights) {
     uint64_t attacks = 0;
-    uint64_t knight = knights;
-    while(knight) {
-        uint64_t single_knight = knight & -knight;
-        uint64_t target_attacks = 0;
-        if (single_knight & ~file_masks[0] & ~file_masks[1]) target_attacks |= (single_knight << 6) | (single_knight >> 10);
-        if (single_knight & ~file_masks[0]) target_attacks |= (single_knight << 15) | (single_knight >> 17);
-        if (single_knight & ~file_masks[7] & ~file_masks[6]) target_attacks |= (single_knight << 10) | (single_knight >> 6);
-        if (single_knight & ~file_masks[7]) target_attacks |= (single_knight << 17) | (single_knight >> 15);
-        attacks |= target_attacks;
-        knight &= knight - 1;
+    while (knights) {
+        attacks |= KNIGHT_ATTACKS[getSquareIndex(knights)];
+        knights &= knights - 1;
     }
     return attacks;
 }
 
 uint64_t Board::getKingAttacks(uint64_t king) {
-    uint64_t attacks = 0;
-    uint64_t right = (king << 1) & ~file_masks[0];
-    uint64_t left = (king >> 1) & ~file_masks[7];
-    uint64_t up = king << 8;
-    uint64_t down = king >> 8;
-    uint64_t up_right = (king << 9) & ~file_masks[0];
-    uint64_t up_left = (king << 7) & ~file_masks[7];
-    uint64_t down_right = (king >> 7) & ~file_masks[0];
-    uint64_t down_left = (king >> 9) & ~file_masks[7];
-    attacks = right | left | up | down | up_right | up_left | down_right | down_left;
-    return attacks;
-}
-
-uint64_t Board::getSlidingAttacks(uint64_t pieces, uint64_t allPieces, bool isRook) {
-    uint64_t attacks = 0;
-    while (pieces) {
-        uint64_t single_piece = pieces & -pieces;
-        uint64_t occupied = allPieces;
-        int shifts[] = { -1, 1, -8, 8 };
-        if (!isRook) { shifts[0] = -9; shifts[1] = -7; shifts[2] = 7; shifts[3] = 9; }
-        for (int shift : shifts) {
-            uint64_t temp_attacks = 0;
-            uint64_t current_square = single_piece;
-            bool is_diagonal = (shift == 7 || shift == -7 || shift == 9 || shift == -9);
-            bool is_left_move = (shift == -1 || shift == -9 || shift == 7);
-            bool is_right_move = (shift == 1 || shift == 9 || shift == -7);
-            while (true) {
-                uint64_t next_square = (shift > 0) ? (current_square << std::abs(shift)) : (current_square >> std::abs(shift));
-                if (next_square == 0 || (is_left_move && (next_square & file_masks[7])) || (is_right_move && (next_square & file_masks[0]))) break;
-                if (is_diagonal) {
-                    int current_rank = getSquareIndex(current_square) >> 3;
-                    int next_rank = getSquareIndex(next_square) >> 3;
-                    if (std::abs(current_rank - next_rank) != 1) break;
-                }
-                temp_attacks |= next_square;
-                current_square = next_square;
-                if (occupied & next_square) break;
-            }
-            attacks |= temp_attacks;
-        }
-        pieces &= pieces - 1;
-    }
-    return attacks;
+    if (king == 0) return 0;
+    return KING_ATTACKS[getSquareIndex(king)];
 }
 
 // areSquaresAttacked checks if the given squares are attacked by the pieces of the given color
 bool Board::areSquaresAttacked(uint64_t squares, Color opponentColor) {
-    uint64_t opponentPawns = (opponentColor == Color::BLACK) ? blackPawns : whitePawns;
-    uint64_t opponentKnights = (opponentColor == Color::BLACK) ? blackKnights : whiteKnights;
-    uint64_t opponentBishops = (opponentColor == Color::BLACK) ? blackBishops : whiteBishops;
-    uint64_t opponentRooks = (opponentColor == Color::BLACK) ? blackRooks : whiteRooks;
-    uint64_t opponentQueens = (opponentColor == Color::BLACK) ? blackQueens : whiteQueens;
-    uint64_t opponentKing = (opponentColor == Color::BLACK) ? blackKing : whiteKing;
-    uint64_t allPieces = blackPawns | blackKnights | blackBishops | blackRooks | blackQueens | blackKing |
-                         whitePawns | whiteKnights | whiteBishops | whiteRooks | whiteQueens | whiteKing;
-    if ((getPawnAttacks(opponentColor, opponentPawns) & squares) != 0) return true;
-    if ((getKnightAttacks(opponentKnights) & squares) != 0) return true;
-    if ((getKingAttacks(opponentKing) & squares) != 0) return true;
-    if ((getSlidingAttacks(opponentRooks | opponentQueens, allPieces, true) & squares) != 0) return true;
-    if ((getSlidingAttacks(opponentBishops | opponentQueens, allPieces, false) & squares) != 0) return true;
-    return false;
+    return opponentColor == Color::WHITE ? areSquaresAttacked<Color::WHITE>(squares)
+                                         : areSquaresAttacked<Color::BLACK>(squares);
+}
+
+template <Color Them>
+bool Board::areSquaresAttacked(uint64_t squares) {
+    return (attackedBy<Them>() & squares) != 0;
+}
+
+// Every square the given color attacks. The defending king is lifted off the
+// board so the squares behind it along a checking slider's ray count as
+// attacked; that is what king moves need, and it changes nothing else, since
+// those squares only differ while the king is in check.
+template <Color Them>
+uint64_t Board::attackedBy() {
+    constexpr int them = Side<Them>::us;
+    if (attackMapValid[them]) return attackMap[them];
+
+    const uint64_t* opponent = pieces[them];
+    uint64_t occupied = occupancy ^ pieces[them ^ 1][KING];
+    uint64_t attacks = getPawnAttacks(Them, opponent[PAWN]) | getKnightAttacks(opponent[KNIGHT]) |
+                       getKingAttacks(opponent[KING]);
+    attacks |= sliderAttackMap(opponent[ROOK] | opponent[QUEEN], opponent[BISHOP] | opponent[QUEEN], occupied);
+
+    attackMap[them] = attacks;
+    attackMapValid[them] = true;
+    return attacks;
 }
 
 bool Board::isKingInCheck(Color kingColor) {
-    uint64_t kingSquare = (kingColor == Color::WHITE) ? whiteKing : blackKing;
     Color opponentColor = (kingColor == Color::WHITE) ? Color::BLACK : Color::WHITE;
-    return areSquaresAttacked(kingSquare, opponentColor);
+    return areSquaresAttacked(pieces[static_cast<int>(kingColor)][KING], opponentColor);
 }
 
 void Board::setVerbose(bool verbose) {
@@ -476,43 +809,43 @@ void Board::setVerbose(bool verbose) {
 }
 
 int Board::getNumWhiteKnights() {
-    return std::popcount(whiteKnights);
+    return std::popcount(pieces[WHITE][KNIGHT]);
 }
 
 int Board::getNumWhiteRooks() {
-    return std::popcount(whiteRooks);
+    return std::popcount(pieces[WHITE][ROOK]);
 }
 
 int Board::getNumWhiteQueens() {
-    return std::popcount(whiteQueens);
+    return std::popcount(pieces[WHITE][QUEEN]);
 }
 
 int Board::getNumWhitePawns() {
-    return std::popcount(whitePawns);
+    return std::popcount(pieces[WHITE][PAWN]);
 }
 
 int Board::getNumWhiteBishops() {
-    return std::popcount(whiteBishops);
+    return std::popcount(pieces[WHITE][BISHOP]);
 }
 
 int Board::getNumBlackKnights() {
-    return std::popcount(blackKnights);
+    return std::popcount(pieces[BLACK][KNIGHT]);
 }
 
 int Board::getNumBlackRooks() {
-    return std::popcount(blackRooks);
+    return std::popcount(pieces[BLACK][ROOK]);
 }
 
 int Board::getNumBlackQueens() {
-    return std::popcount(blackQueens);
+    return std::popcount(pieces[BLACK][QUEEN]);
 }
 
 int Board::getNumBlackPawns() {
-    return std::popcount(blackPawns);
+    return std::popcount(pieces[BLACK][PAWN]);
 }
 
 int Board::getNumBlackBishops() {
-    return std::popcount(blackBishops);
+    return std::popcount(pieces[BLACK][BISHOP]);
 }
 
 bool Board::isInsufficientMaterial() {
@@ -553,7 +886,7 @@ bool Board::isInsufficientMaterial() {
     }
 
     if (numWhitePieces == 1 && numWhiteBishops == 1 && numBlackPieces == 1 && numBlackBishops == 1) {
-        if (getSquareIndex(whiteBishops) + getSquareIndex(blackBishops) % 2 == 0) {
+        if (getSquareIndex(pieces[WHITE][BISHOP]) + getSquareIndex(pieces[BLACK][BISHOP]) % 2 == 0) {
             return true;
         }
     }
@@ -566,29 +899,28 @@ bool Board::isInsufficientMaterial() {
 }
 
 bool Board::makeMove(Move move) {
-    Board tempBoard = *this;
-    if (!tempBoard.applyMove(move)) {
+    return makeMove(encodeMove(move));
+}
+
+bool Board::makeMove(PackedMove move) {
+    Color mover = this->sideToMove;
+    UndoInfo undo;
+    if (!doMove(move, undo)) {
         std::cout << "Error: Invalid move based on piece rules or board state." << std::endl;
         return false;
     }
-    if (tempBoard.isKingInCheck(this->sideToMove)) {
+    if (isKingInCheck(mover)) {
+        undoMove(undo);
         std::cout << "Error: This move leaves the king in check. Move is illegal." << std::endl;
         return false;
     }
-    if (this->applyMove(move)) {
-        if (this->sideToMove == Color::WHITE) this->sideToMove = Color::BLACK;
-        else this->sideToMove = Color::WHITE;
-        return true;
-    }
-
-    std::cout << "Error: Should not be here" << std::endl;
-    return false;
+    return true;
 }
 
 bool Board::isKingInCheckmate(Color kingColor) {
     // 1. First, check if the king is even in check. If not, it can't be checkmate.
     Color opponentColor = (kingColor == Color::WHITE) ? Color::BLACK : Color::WHITE;
-    uint64_t kingSquare = (kingColor == Color::WHITE) ? whiteKing : blackKing;
+    uint64_t kingSquare = pieces[static_cast<int>(kingColor)][KING];
 
     if (!isKingInCheck(kingColor)) {
         // std::cout << "I'm not in check on: " << toAlgebraicNotation(static_cast<Square>(kingSquare)) << std::endl;
@@ -598,20 +930,19 @@ bool Board::isKingInCheckmate(Color kingColor) {
     // 2. Generate and check all possible king moves.
     // This is the fastest way to get out of check.
     uint64_t kingAttacks = getKingAttacks(kingSquare);
-    uint64_t friendlyPieces = (kingColor == Color::WHITE) ? 
-        (whitePawns | whiteKnights | whiteBishops | whiteRooks | whiteQueens | whiteKing) :
-        (blackPawns | blackKnights | blackBishops | blackRooks | blackQueens | blackKing);
+    uint64_t friendlyPieces = colorOccupancy[static_cast<int>(kingColor)];
     uint64_t kingLegalMoves = kingAttacks & ~friendlyPieces;
     
     while (kingLegalMoves) {
         uint64_t end_bit = kingLegalMoves & -kingLegalMoves;
         // std::cout << "Considering king move: " << toAlgebraicNotation(static_cast<Square>(kingSquare)) << " -> " << toAlgebraicNotation(static_cast<Square>(end_bit)) << std::endl;
-        Board tempBoard = *this;
-        if (tempBoard.applyMove({static_cast<Square>(kingSquare), static_cast<Square>(end_bit)})) {
-            if (!tempBoard.isKingInCheck(kingColor)) {
+        UndoInfo undo;
+        if (doMove({static_cast<Square>(kingSquare), static_cast<Square>(end_bit)}, undo)) {
+            bool stillInCheck = isKingInCheck(kingColor);
+            undoMove(undo);
+            if (!stillInCheck) {
                 return false; // King can move to a safe square
             }
-            // std::cout << "king is attacked on: " << toAlgebraicNotation(static_cast<Square>(end_bit)) << std::endl;
         }
         kingLegalMoves &= kingLegalMoves - 1;
     }
@@ -620,37 +951,16 @@ bool Board::isKingInCheckmate(Color kingColor) {
     // Note: This logic assumes a single check. Handling double checks is a special case.
     uint64_t checkers = 0;
     
-    uint64_t opponentPawns = (opponentColor == Color::BLACK) ? blackPawns : whitePawns;
-    uint64_t opponentKnights = (opponentColor == Color::BLACK) ? blackKnights : whiteKnights;
-    uint64_t opponentBishops = (opponentColor == Color::BLACK) ? blackBishops : whiteBishops;
-    uint64_t opponentRooks = (opponentColor == Color::BLACK) ? blackRooks : whiteRooks;
-    uint64_t opponentQueens = (opponentColor == Color::BLACK) ? blackQueens : whiteQueens;
-    uint64_t allPieces = blackPawns | blackKnights | blackBishops | blackRooks | blackQueens | blackKing |
-                         whitePawns | whiteKnights | whiteBishops | whiteRooks | whiteQueens | whiteKing;
-
-    // Check for pawn attacks
-    if (opponentColor == Color::BLACK) {
-        checkers |= ((kingSquare << 7) & ~file_masks[7]) & opponentPawns;
-        checkers |= ((kingSquare << 9) & ~file_masks[0]) & opponentPawns;
-    } else {
-        checkers |= ((kingSquare >> 7) & ~file_masks[0]) & opponentPawns;
-        checkers |= ((kingSquare >> 9) & ~file_masks[7]) & opponentPawns;
-    }
+    const uint64_t* opponent = pieces[static_cast<int>(opponentColor)];
 
-    // Check for knight attacks
-    if (getKnightAttacks(opponentKnights) & kingSquare) {
-        checkers |= getKnightAttacks(kingSquare) & opponentKnights;
-    }
+    // Check for pawn and knight attacks
+    int kingIndex = getSquareIndex(kingSquare);
+    checkers |= PAWN_ATTACKS[static_cast<int>(kingColor)][kingIndex] & opponent[PAWN];
+    checkers |= KNIGHT_ATTACKS[kingIndex] & opponent[KNIGHT];
 
-    // Check for rook/queen attacks
-    if (getSlidingAttacks(opponentRooks | opponentQueens, allPieces, true) & kingSquare) {
-        checkers |= getSlidingAttacks(kingSquare, allPieces, true) & (opponentRooks | opponentQueens);
-    }
-    
-    // Check for bishop/queen attacks
-    if (getSlidingAttacks(opponentBishops | opponentQueens, allPieces, false) & kingSquare) {
-        checkers |= getSlidingAttacks(kingSquare, allPieces, false) & (opponentBishops | opponentQueens);
-    }
+    // Check for rook/queen and bishop/queen attacks
+    checkers |= rookAttacks(kingIndex, occupancy) & (opponent[ROOK] | opponent[QUEEN]);
+    checkers |= bishopAttacks(kingIndex, occupancy) & (opponent[BISHOP] | opponent[QUEEN]);
     // Don't check for king-on-king attacks, as they are not legal.
 
     // If there is more than one checking piece, it's a double check.
@@ -668,10 +978,11 @@ bool Board::isKingInCheckmate(Color kingColor) {
     
     while(friendlyPiecesExceptKing) {
         uint64_t start_bit = friendlyPiecesExceptKing & -friendlyPiecesExceptKing;
-        Board tempBoard = *this;
-        // The applyMove function should handle the capture
-        if (tempBoard.applyMove({static_cast<Square>(start_bit), static_cast<Square>(checker_square)})) {
-            if (!tempBoard.isKingInCheck(kingColor)) {
+        UndoInfo undo;
+        if (doMove({static_cast<Square>(start_bit), static_cast<Square>(checker_square)}, undo)) {
+            bool stillInCheck = isKingInCheck(kingColor);
+            undoMove(undo);
+            if (!stillInCheck) {
                 return false; // Found a legal capture
             }
         }
@@ -679,7 +990,7 @@ bool Board::isKingInCheckmate(Color kingColor) {
     }
     
     // 5. Check for blocks if the checker is a sliding piece.
-    if (!((blackKnights | whiteKnights | blackPawns | whitePawns) & checker_square)) {
+    if (!((pieces[BLACK][KNIGHT] | pieces[WHITE][KNIGHT] | pieces[BLACK][PAWN] | pieces[WHITE][PAWN]) & checker_square)) {
         // Only sliding pieces can be blocked.
         uint64_t path = 0;
         uint8_t start_index = getSquareIndex(checker_square);
@@ -703,9 +1014,7 @@ bool Board::isKingInCheckmate(Color kingColor) {
             }
         }
 
-        uint64_t friendlyBlockers = (kingColor == Color::WHITE) ?
-            (whitePawns | whiteKnights | whiteBishops | whiteRooks | whiteQueens) :
-            (blackPawns | blackKnights | blackBishops | blackRooks | blackQueens);
+        uint64_t friendlyBlockers = friendlyPieces & ~kingSquare;
 
         while(friendlyBlockers) {
             uint64_t start_bit = friendlyBlockers & -friendlyBlockers;
@@ -713,9 +1022,11 @@ bool Board::isKingInCheckmate(Color kingColor) {
             
             while(end_squares) {
                 uint64_t end_bit = end_squares & -end_squares;
-                Board tempBoard = *this;
-                if (tempBoard.applyMove({static_cast<Square>(start_bit), static_cast<Square>(end_bit)})) {
-                    if (!tempBoard.isKingInCheck(kingColor)) {
+                UndoInfo undo;
+                if (doMove({static_cast<Square>(start_bit), static_cast<Square>(end_bit)}, undo)) {
+                    bool stillInCheck = isKingInCheck(kingColor);
+                    undoMove(undo);
+                    if (!stillInCheck) {
                         return false; // Found a legal block
                     }
                 }
@@ -729,181 +1040,88 @@ bool Board::isKingInCheckmate(Color kingColor) {
     return true;
 }
 
-std::vector<Move> Board::generatePseudoLegalMoves() {
-    std::vector<Move> pseudoLegalMoves;
-
-    std::vector<Move> pawnMoves = generatePawnMoves();
-    // for (const Move& move : pawnMoves) {
-    //     std::cout << "pawn move (" << toAlgebraicNotation(move.start) << ", " << toAlgebraicNotation(move.end) << ")" << std::endl;
-    // }
-
-    std::vector<Move> knightMoves = generateKnightMoves();
-    // for (const Move& move : knightMoves) {
-    //     std::cout << "knight move (" << toAlgebraicNotation(move.start) << ", " << toAlgebraicNotation(move.end) << ")" << std::endl;
-    // }
-
-    std::vector<Move> bishopMoves = generateBishopMoves();
-    // for (const Move& move : bishopMoves) {
-    //     std::cout << "bishop move (" << toAlgebraicNotation(move.start) << ", " << toAlgebraicNotation(move.end) << ")" << std::endl;
-    // }
-
-    std::vector<Move> rookMoves = generateRookMoves();
-    // for (const Move& move : rookMoves) {
-    //     std::cout << "rook move (" << toAlgebraicNotation(move.start) << ", " << toAlgebraicNotation(move.end) << ")" << std::endl;
-    // }
-
-    std::vector<Move> queenMoves = generateQueenMoves();
-    // for (const Move& move : queenMoves) {
-    //     std::cout << "queen move (" << toAlgebraicNotation(move.start) << ", " << toAlgebraicNotation(move.end) << ")" << std::endl;
-    // }
-
-    std::vector<Move> kingMoves = generateKingMoves();
-    // for (const Move& move : kingMoves) {
-    //     std::cout << "king move (" << toAlgebraicNotation(move.start) << ", " << toAlgebraicNotation(move.end) << ")" << std::endl;
-    // }
-    
-    // Generate all pseudo-legal moves for the current side
-    pseudoLegalMoves.insert(pseudoLegalMoves.end(), pawnMoves.begin(), pawnMoves.end());
-    pseudoLegalMoves.insert(pseudoLegalMoves.end(), knightMoves.begin(), knightMoves.end());
-    pseudoLegalMoves.insert(pseudoLegalMoves.end(), bishopMoves.begin(), bishopMoves.end());
-    pseudoLegalMoves.insert(pseudoLegalMoves.end(), rookMoves.begin(), rookMoves.end());
-    pseudoLegalMoves.insert(pseudoLegalMoves.end(), queenMoves.begin(), queenMoves.end());
-    pseudoLegalMoves.insert(pseudoLegalMoves.end(), kingMoves.begin(), kingMoves.end());
+void Board::generatePseudoLegalMoves(MoveList& moves) {
+    moves.clear();
+    if (sideToMove == Color::WHITE) generatePseudoLegal<Color::WHITE>(moves);
+    else generatePseudoLegal<Color::BLACK>(moves);
+}
 
-    return pseudoLegalMoves;
+template <Color Us>
+void Board::generatePseudoLegal(MoveList& moves) {
+    uint64_t targets = ~colorOccupancy[Side<Us>::us];
+    generatePawnMoves<Us, MoveGenType::ALL>(moves, targets, 0, false);
+    generatePieceMoves<Us, PieceType::KNIGHT>(moves, targets, 0);
+    generatePieceMoves<Us, PieceType::BISHOP>(moves, targets, 0);
+    generatePieceMoves<Us, PieceType::ROOK>(moves, targets, 0);
+    generatePieceMoves<Us, PieceType::QUEEN>(moves, targets, 0);
+    generateKingMoves<Us>(moves);
+}
+
+std::vector<Move> Board::generatePseudoLegalMoves() {
+    MoveList moves;
+    generatePseudoLegalMoves(moves);
+    std::vector<Move> result;
+    for (PackedMove move : moves) result.push_back(move.toMove());
+    return result;
 }
 
 // --- Move Generation Helper Functions ---
-std::vector<Move> Board::generatePawnMoves() {
-    std::vector<Move> moves;
-    uint64_t pawns = (sideToMove == Color::WHITE) ? whitePawns : blackPawns;
-    uint64_t allPieces = whitePawns | whiteKnights | whiteBishops | whiteRooks | whiteQueens | whiteKing |
-                         blackPawns | blackKnights | blackBishops | blackRooks | blackQueens | blackKing;
-    
-    while (pawns) {
-        uint64_t start_bit = pawns & -pawns;
-        Square start = static_cast<Square>(start_bit);
-
-        if (sideToMove == Color::WHITE) {
-            // Single push
-            uint64_t end_bit = start_bit << 8;
-            bool isWhitePromoting = (end_bit & 0xFF00000000000000ULL) != 0;
-            if (!(allPieces & end_bit)) {
-                if (!isWhitePromoting) {
-                    moves.push_back({start, static_cast<Square>(end_bit)});
-                } else {
-                    moves.push_back({start, static_cast<Square>(end_bit), PieceType::QUEEN});
-                    moves.push_back({start, static_cast<Square>(end_bit), PieceType::KNIGHT});
-                    moves.push_back({start, static_cast<Square>(end_bit), PieceType::ROOK});
-                    moves.push_back({start, static_cast<Square>(end_bit), PieceType::BISHOP});
-                }
-            }
-                
-            // Double push
-            end_bit = start_bit << 16;
-            if ((start_bit & RANK_2) && !(allPieces & (start_bit << 8)) && !(allPieces & end_bit)) {
-                moves.push_back({start, static_cast<Square>(end_bit)});
-            }
-                
-            // Captures
-            uint64_t capture1 = (start_bit << 7) & ~file_masks[7];
-            if ((blackPawns | blackKnights | blackBishops | blackRooks | blackQueens | blackKing) & capture1) {
-                if (!isWhitePromoting) {
-                    moves.push_back({start, static_cast<Square>(capture1)});
-                } else {
-                    moves.push_back({start, static_cast<Square>(capture1), PieceType::QUEEN});
-                    moves.push_back({start, static_cast<Square>(capture1), PieceType::KNIGHT});
-                    moves.push_back({start, static_cast<Square>(capture1), PieceType::ROOK});
-                    moves.push_back({start, static_cast<Square>(capture1), PieceType::BISHOP});
-                }
+template <Color Us, MoveGenType Type>
+void Board::generatePawnMoves(MoveList& moves, uint64_t targets, uint64_t pinned, bool legal) {
+    using S = Side<Us>;
+    constexpr bool captures = Type != MoveGenType::QUIETS;
+    constexpr bool quiets = Type != MoveGenType::CAPTURES;
+    uint64_t pawns = pieces[S::us][PAWN];
+    uint64_t enemyPieces = colorOccupancy[S::us ^ 1];
+    uint64_t allPieces = occupancy;
+
+    // Adds a pawn move, expanding it into the promotions on the last rank.
+    // A capturing promotion is a capture whatever the new piece; of the
+    // pushes, the queen promotion counts as a capture and the
+    // underpromotions as quiet moves.
+    auto addPawnMove = [&](int from, int to, bool isCapture) {
+        if ((1ULL << to) & S::promotionRank) {
+            if (captures) moves.push_back(PackedMove(from, to, PackedMove::PROMOTION, PieceType::QUEEN));
+            if (isCapture ? captures : quiets) {
+                moves.push_back(PackedMove(from, to, PackedMove::PROMOTION, PieceType::KNIGHT));
+                moves.push_back(PackedMove(from, to, PackedMove::PROMOTION, PieceType::ROOK));
+                moves.push_back(PackedMove(from, to, PackedMove::PROMOTION, PieceType::BISHOP));
             }
-                
-            uint64_t capture2 = (start_bit << 9) & ~file_masks[0];
-            if ((blackPawns | blackKnights | blackBishops | blackRooks | blackQueens | blackKing) & capture2) {
-                if (!isWhitePromoting) {
-                    moves.push_back({start, static_cast<Square>(capture2)});
-                } else {
-                    moves.push_back({start, static_cast<Square>(capture2), PieceType::QUEEN});
-                    moves.push_back({start, static_cast<Square>(capture2), PieceType::KNIGHT});
-                    moves.push_back({start, static_cast<Square>(capture2), PieceType::ROOK});
-                    moves.push_back({start, static_cast<Square>(capture2), PieceType::BISHOP});
-                }
-            }
-               
-            // En Passant
-            if (enPassent && (capture1 == enPassent || capture2 == enPassent)) {
-                 moves.push_back({start, static_cast<Square>(enPassent)});
-            }
-        } else { // Black
-            // Single push
-            uint64_t end_bit = start_bit >> 8;
-            bool isBlackPromoting = (end_bit & 0x00000000000000FFULL) != 0;
-            if (!(allPieces & end_bit)) {
-                if (!isBlackPromoting) {
-                    moves.push_back({start, static_cast<Square>(end_bit)});
-                } else {
-                    moves.push_back({start, static_cast<Square>(end_bit), PieceType::QUEEN});
-                    moves.push_back({start, static_cast<Square>(end_bit), PieceType::KNIGHT});
-                    moves.push_back({start, static_cast<Square>(end_bit), PieceType::ROOK});
-                    moves.push_back({start, static_cast<Square>(end_bit), PieceType::BISHOP});
-                }
-            }
-            // Double push
-            end_bit = start_bit >> 16;
-            if ((start_bit & RANK_7) && !(allPieces & (start_bit >> 8)) && !(allPieces & end_bit)) {
-                moves.push_back({start, static_cast<Square>(end_bit)});
-            }
-                
-            // Captures
-            uint64_t capture1 = (start_bit >> 7) & ~file_masks[0];
-            if ((whitePawns | whiteKnights | whiteBishops | whiteRooks | whiteQueens | whiteKing) & capture1) {
-                if (!isBlackPromoting) {
-                    moves.push_back({start, static_cast<Square>(capture1)});
-                } else {
-                    moves.push_back({start, static_cast<Square>(capture1), PieceType::QUEEN});
-                    moves.push_back({start, static_cast<Square>(capture1), PieceType::KNIGHT});
-                    moves.push_back({start, static_cast<Square>(capture1), PieceType::ROOK});
-                    moves.push_back({start, static_cast<Square>(capture1), PieceType::BISHOP});
-                }
-            }
-            uint64_t capture2 = (start_bit >> 9) & ~file_masks[7];
-            if ((whitePawns | whiteKnights | whiteBishops | whiteRooks | whiteQueens | whiteKing) & capture2) {
-                if (!isBlackPromoting) {
-                    moves.push_back({start, static_cast<Square>(capture2)});
-                } else {
-                    moves.push_back({start, static_cast<Square>(capture2), PieceType::QUEEN});
-                    moves.push_back({start, static_cast<Square>(capture2), PieceType::KNIGHT});
-                    moves.push_back({start, static_cast<Square>(capture2), PieceType::ROOK});
-                    moves.push_back({start, static_cast<Square>(capture2), PieceType::BISHOP});
-                }
-            }
-                
-            // En Passant
-            if (enPassent && (capture1 == enPassent || capture2 == enPassent)) {
-                moves.push_back({start, static_cast<Square>(enPassent)});
+        } else if (isCapture ? captures : quiets) {
+            moves.push_back(PackedMove(from, to));
+        }
+    };
+
+    while (pawns) {
+        int from = getSquareIndex(pawns);
+        uint64_t start_bit = 1ULL << from;
+        // A pinned pawn may only move along the line through its king.
+        uint64_t allowed = targets;
+        if (pinned & start_bit) allowed &= lineBB(kingSquareIndex(Us), from);
+
+        // Single and double pushes
+        int to = from + S::forward;
+        if (!(allPieces & (1ULL << to))) {
+            if (allowed & (1ULL << to)) addPawnMove(from, to, false);
+            int doubleTo = to + S::forward;
+            if (quiets && (start_bit & S::doublePushFrom) && !(allPieces & (1ULL << doubleTo)) && (allowed & (1ULL << doubleTo))) {
+                moves.push_back(PackedMove(from, doubleTo));
             }
         }
-        pawns &= ~start_bit;
-    }
-    return moves;
-}
 
-std::vector<Move> Board::generateKnightMoves() {
-    std::vector<Move> moves;
-    uint64_t knights = (sideToMove == Color::WHITE) ? whiteKnights : blackKnights;
-    uint64_t friendlyPieces = (sideToMove == Color::WHITE) ? (whitePawns|whiteKnights|whiteBishops|whiteRooks|whiteQueens|whiteKing) : (blackPawns|blackKnights|blackBishops|blackRooks|blackQueens|blackKing);
-    while (knights) {
-        uint64_t start_bit = knights & -knights;
-        uint64_t attacks = getKnightAttacks(start_bit);
-        uint64_t valid_moves = attacks & ~friendlyPieces;
-        while(valid_moves) {
-            uint64_t end_bit = valid_moves & -valid_moves;
-            moves.push_back({static_cast<Square>(start_bit), static_cast<Square>(end_bit)});
-            valid_moves &= valid_moves - 1;
+        // Captures
+        uint64_t attacks = PAWN_ATTACKS[S::us][from] & enemyPieces & allowed;
+        while (attacks) {
+            addPawnMove(from, getSquareIndex(attacks), true);
+            attacks &= attacks - 1;
         }
-        knights &= knights - 1;
+
+        // En Passant
+        if (captures && (PAWN_ATTACKS[S::us][from] & enPassent) && (!legal || isEnPassentLegal<Us>(from))) {
+            moves.push_back(PackedMove(from, getSquareIndex(enPassent), PackedMove::EN_PASSANT));
+        }
+        pawns &= pawns - 1;
     }
-    return moves;
 }
 
 // Helper function to convert a PieceType enum to a string for logging
@@ -913,98 +1131,361 @@ std::string pieceTypeToString(PieceType piece) {
         case PieceType::ROOK: return "Rook";
         case PieceType::KNIGHT: return "Knight";
         case PieceType::BISHOP: return "Bishop";
+        case PieceType::PAWN: return "Pawn";
+        case PieceType::KING: return "King";
     }
     return ""; // Should not be reached
 }
 
-std::vector<Move> Board::generateBishopMoves() {
-    std::vector<Move> moves;
-    uint64_t bishops = (sideToMove == Color::WHITE) ? whiteBishops : blackBishops;
-    uint64_t allPieces = whitePawns|whiteKnights|whiteBishops|whiteRooks|whiteQueens|whiteKing |
-                         blackPawns|blackKnights|blackBishops|blackRooks|blackQueens|blackKing;
-    uint64_t friendlyPieces = (sideToMove == Color::WHITE) ? (whitePawns|whiteKnights|whiteBishops|whiteRooks|whiteQueens|whiteKing) : (blackPawns|blackKnights|blackBishops|blackRooks|blackQueens|blackKing);
-    
-    while (bishops) {
-        uint64_t start_bit = bishops & -bishops;
-        uint64_t attacks = getSlidingAttacks(start_bit, allPieces, false);
-        uint64_t valid_moves = attacks & ~friendlyPieces;
-        while(valid_moves) {
-            uint64_t end_bit = valid_moves & -valid_moves;
-            moves.push_back({static_cast<Square>(start_bit), static_cast<Square>(end_bit)});
+// Knight, bishop, rook and queen moves; the attack lookup is chosen at compile time.
+template <Color Us, PieceType Type>
+void Board::generatePieceMoves(MoveList& moves, uint64_t targets, uint64_t pinned) {
+    uint64_t pieceSet = pieces[Side<Us>::us][static_cast<int>(Type)];
+    while (pieceSet) {
+        int from = getSquareIndex(pieceSet);
+        uint64_t attacks;
+        if constexpr (Type == PieceType::KNIGHT) attacks = KNIGHT_ATTACKS[from];
+        else if constexpr (Type == PieceType::BISHOP) attacks = bishopAttacks(from, occupancy);
+        else if constexpr (Type == PieceType::ROOK) attacks = rookAttacks(from, occupancy);
+        else attacks = queenAttacks(from, occupancy);
+
+        uint64_t valid_moves = attacks & targets;
+        if (pinned & (1ULL << from)) valid_moves &= lineBB(kingSquareIndex(Us), from);
+        while (valid_moves) {
+            moves.push_back(PackedMove(from, getSquareIndex(valid_moves)));
             valid_moves &= valid_moves - 1;
         }
-        bishops &= bishops - 1;
+        pieceSet &= pieceSet - 1;
     }
-    return moves;
 }
 
-std::vector<Move> Board::generateRookMoves() {
-    std::vector<Move> moves;
-    uint64_t rooks = (sideToMove == Color::WHITE) ? whiteRooks : blackRooks;
-    uint64_t allPieces = whitePawns|whiteKnights|whiteBishops|whiteRooks|whiteQueens|whiteKing |
-                         blackPawns|blackKnights|blackBishops|blackRooks|blackQueens|blackKing;
-    uint64_t friendlyPieces = (sideToMove == Color::WHITE) ? (whitePawns|whiteKnights|whiteBishops|whiteRooks|whiteQueens|whiteKing) : (blackPawns|blackKnights|blackBishops|blackRooks|blackQueens|blackKing);
+template <Color Us>
+void Board::generateKingMoves(MoveList& moves) {
+    using S = Side<Us>;
+    uint64_t king = pieces[S::us][KING];
+    uint64_t friendlyPieces = colorOccupancy[S::us];
     
-    while (rooks) {
-        uint64_t start_bit = rooks & -rooks;
-        uint64_t attacks = getSlidingAttacks(start_bit, allPieces, true);
-        uint64_t valid_moves = attacks & ~friendlyPieces;
-        while(valid_moves) {
-            uint64_t end_bit = valid_moves & -valid_moves;
-            moves.push_back({static_cast<Square>(start_bit), static_cast<Square>(end_bit)});
-            valid_moves &= valid_moves - 1;
+    uint64_t attacks = getKingAttacks(king);
+    uint64_t valid_moves = attacks & ~friendlyPieces;
+    while(valid_moves) {
+        uint64_t end_bit = valid_moves & -valid_moves;
+        moves.push_back(PackedMove(getSquareIndex(king), getSquareIndex(end_bit)));
+        valid_moves &= valid_moves - 1;
+    }
+    // Castling
+    if (king == (1ULL << S::kingHome)) {
+        bool kingside = S::white ? whiteCastleKingside : blackCastleKingside;
+        bool queenside = S::white ? whiteCastleQueenside : blackCastleQueenside;
+        if (kingside && !((occupancy & ~king) & S::kingsidePath))
+            moves.push_back(PackedMove(S::kingHome, S::kingHome + 2, PackedMove::CASTLING));
+        if (queenside && !((occupancy & ~king) & S::queensidePath))
+            moves.push_back(PackedMove(S::kingHome, S::kingHome - 2, PackedMove::CASTLING));
+    }
+}
+
+template <Color Us, MoveGenType Type>
+void Board::generateLegalKingMoves(MoveList& moves, uint64_t checkers) {
+    using S = Side<Us>;
+    uint64_t king = pieces[S::us][KING];
+    int from = getSquareIndex(king);
+    uint64_t friendlyPieces = colorOccupancy[S::us];
+    uint64_t enemyPieces = colorOccupancy[S::us ^ 1];
+    uint64_t allPieces = occupancy;
+    uint64_t enemyAttacks = attackedBy<S::them>();
+
+    uint64_t valid_moves = KING_ATTACKS[from] & ~friendlyPieces & ~enemyAttacks;
+    if constexpr (Type == MoveGenType::CAPTURES) valid_moves &= enemyPieces;
+    if constexpr (Type == MoveGenType::QUIETS) valid_moves &= ~enemyPieces;
+    while (valid_moves) {
+        moves.push_back(PackedMove(from, getSquareIndex(valid_moves)));
+        valid_moves &= valid_moves - 1;
+    }
+
+    if (Type == MoveGenType::CAPTURES || checkers || from != S::kingHome) return;
+
+    // Castling: rights held, rook at home, path empty and no square the king
+    // crosses attacked.
+    auto castleIfSafe = [&](bool right, int rookSquare, uint64_t path, uint64_t safe, int to) {
+        if (!right || !(pieces[S::us][ROOK] & (1ULL << rookSquare)) || (allPieces & (path & ~king))) return;
+        if (enemyAttacks & safe & ~king) return;
+        moves.push_back(PackedMove(from, to, PackedMove::CASTLING));
+    };
+    castleIfSafe(S::white ? whiteCastleKingside : blackCastleKingside, S::kingHome + 3, S::kingsidePath, S::kingsideSafe, S::kingHome + 2);
+    castleIfSafe(S::white ? whiteCastleQueenside : blackCastleQueenside, S::kingHome - 4, S::queensidePath, S::queensideSafe, S::kingHome - 2);
+}
+
+// All pieces of either color attacking the square, given an occupancy.
+uint64_t Board::attackersTo(int square, uint64_t occupied) {
+    return (PAWN_ATTACKS[0][square] & pieces[BLACK][PAWN]) |
+           (PAWN_ATTACKS[1][square] & pieces[WHITE][PAWN]) |
+           (KNIGHT_ATTACKS[square] & (pieces[WHITE][KNIGHT] | pieces[BLACK][KNIGHT])) |
+           (KING_ATTACKS[square] & (pieces[WHITE][KING] | pieces[BLACK][KING])) |
+           (rookAttacks(square, occupied) & (pieces[WHITE][ROOK] | pieces[BLACK][ROOK] | pieces[WHITE][QUEEN] | pieces[BLACK][QUEEN])) |
+           (bishopAttacks(square, occupied) & (pieces[WHITE][BISHOP] | pieces[BLACK][BISHOP] | pieces[WHITE][QUEEN] | pieces[BLACK][QUEEN]));
+}
+
+// Pieces of the given color that are the only blocker between their king
+// and an enemy slider.
+template <Color Us>
+uint64_t Board::pinnedPieces() {
+    constexpr int us = Side<Us>::us;
+    return sliderBlockers(kingSquareIndex(Us), us ^ 1, us);
+}
+
+// Pieces of blockerColor that stand alone between the square and a slider of
+// sliderColor aiming at it. For a king these are its pinned pieces, or, with
+// the attacker's own pieces, the ones that can give a discovered check.
+uint64_t Board::sliderBlockers(int square, int sliderColor, int blockerColor) {
+    uint64_t rookLike = pieces[sliderColor][ROOK] | pieces[sliderColor][QUEEN];
+    uint64_t bishopLike = pieces[sliderColor][BISHOP] | pieces[sliderColor][QUEEN];
+
+    uint64_t result = 0;
+    uint64_t snipers = (rookAttacks(square, 0) & rookLike) | (bishopAttacks(square, 0) & bishopLike);
+    while (snipers) {
+        uint64_t blockers = betweenBB(square, getSquareIndex(snipers)) & occupancy;
+        if (blockers && !(blockers & (blockers - 1)) && (blockers & colorOccupancy[blockerColor])) {
+            result |= blockers;
         }
-        rooks &= rooks - 1;
+        snipers &= snipers - 1;
     }
-    return moves;
+    return result;
 }
 
-std::vector<Move> Board::generateQueenMoves() {
-    std::vector<Move> moves;
-    uint64_t queens = (sideToMove == Color::WHITE) ? whiteQueens : blackQueens;
-    uint64_t allPieces = whitePawns|whiteKnights|whiteBishops|whiteRooks|whiteQueens|whiteKing |
-                         blackPawns|blackKnights|blackBishops|blackRooks|blackQueens|blackKing;
-    uint64_t friendlyPieces = (sideToMove == Color::WHITE) ? (whitePawns|whiteKnights|whiteBishops|whiteRooks|whiteQueens|whiteKing) : (blackPawns|blackKnights|blackBishops|blackRooks|blackQueens|blackKing);
-    
-    while (queens) {
-        uint64_t start_bit = queens & -queens;
-        uint64_t attacks = getSlidingAttacks(start_bit, allPieces, true) | getSlidingAttacks(start_bit, allPieces, false);
-        uint64_t valid_moves = attacks & ~friendlyPieces;
-        while(valid_moves) {
-            uint64_t end_bit = valid_moves & -valid_moves;
-            moves.push_back({static_cast<Square>(start_bit), static_cast<Square>(end_bit)});
-            valid_moves &= valid_moves - 1;
+// En passant removes two pieces from one rank, so check the king directly
+// against the occupancy after the capture.
+template <Color Us>
+bool Board::isEnPassentLegal(int from) {
+    int to = getSquareIndex(enPassent);
+    uint64_t capturedPawn = Side<Us>::white ? (enPassent >> 8) : (enPassent << 8);
+    uint64_t enemyPieces = colorOccupancy[Side<Us>::us ^ 1];
+    uint64_t occupied = (occupancy ^ (1ULL << from) ^ capturedPawn) | (1ULL << to);
+    return !(attackersTo(kingSquareIndex(Us), occupied) & enemyPieces & ~capturedPawn);
+}
+
+int Board::kingSquareIndex(Color color) {
+    return getSquareIndex(pieces[static_cast<int>(color)][KING]);
+}
+
+void Board::setLegacyMoveGeneration(bool legacy) {
+    this->legacyMoveGeneration = legacy;
+}
+
+/**
+ * @brief Generates all legal moves for the current side to move.
+ *
+ * Checkers and pinned pieces are computed once, so every emitted move is
+ * already legal. The legacy path instead filters pseudo-legal moves through
+ * isMoveLegal and is kept for cross-checking.
+ * @param moves The list to fill.
+ */
+void Board::generateLegalMoves(MoveList& moves) {
+    if (legacyMoveGeneration) {
+        generatePseudoLegalMoves(moves);
+        size_t legalCount = 0;
+        for (size_t i = 0; i < moves.size(); ++i) {
+            if (this->isMoveLegal(moves[i])) {
+                moves[legalCount++] = moves[i];
+            }
         }
-        queens &= queens - 1;
+        moves.resize(legalCount);
+        return;
     }
-    return moves;
+
+    moves.clear();
+    if (sideToMove == Color::WHITE) generateLegal<Color::WHITE, MoveGenType::ALL>(moves);
+    else generateLegal<Color::BLACK, MoveGenType::ALL>(moves);
 }
 
-std::vector<Move> Board::generateKingMoves() {
-    std::vector<Move> moves;
-    uint64_t king = (sideToMove == Color::WHITE) ? whiteKing : blackKing;
-    uint64_t friendlyPieces = (sideToMove == Color::WHITE) ? (whitePawns|whiteKnights|whiteBishops|whiteRooks|whiteQueens|whiteKing) : (blackPawns|blackKnights|blackBishops|blackRooks|blackQueens|blackKing);
-    
-    uint64_t attacks = getKingAttacks(king);
-    uint64_t valid_moves = attacks & ~friendlyPieces;
-    while(valid_moves) {
-        uint64_t end_bit = valid_moves & -valid_moves;
-        moves.push_back({static_cast<Square>(king), static_cast<Square>(end_bit)});
-        valid_moves &= valid_moves - 1;
+void Board::generateLegalMoves(MoveList& moves, MoveGenType type) {
+    moves.clear();
+    bool white = sideToMove == Color::WHITE;
+    switch (type) {
+        case MoveGenType::ALL:
+            generateLegalMoves(moves);
+            break;
+        case MoveGenType::CAPTURES:
+            if (white) generateLegal<Color::WHITE, MoveGenType::CAPTURES>(moves);
+            else generateLegal<Color::BLACK, MoveGenType::CAPTURES>(moves);
+            break;
+        case MoveGenType::QUIETS:
+            if (white) generateLegal<Color::WHITE, MoveGenType::QUIETS>(moves);
+            else generateLegal<Color::BLACK, MoveGenType::QUIETS>(moves);
+            break;
+        case MoveGenType::EVASIONS:
+            if (white) generateLegal<Color::WHITE, MoveGenType::EVASIONS>(moves);
+            else generateLegal<Color::BLACK, MoveGenType::EVASIONS>(moves);
+            break;
+        case MoveGenType::QUIET_CHECKS:
+            if (white) generateQuietChecks<Color::WHITE>(moves);
+            else generateQuietChecks<Color::BLACK>(moves);
+            break;
     }
-    // Castling
-    if ((sideToMove == Color::WHITE) && (whiteKing & static_cast<uint64_t>(Square::E1))) {
-        if (whiteCastleKingside && !((whitePawns|whiteKnights|whiteBishops|whiteRooks|whiteQueens|blackPawns|blackKnights|blackBishops|blackRooks|blackQueens|blackKing) & WHITE_KINGSIDE_CASTLE_PATH))
-            moves.push_back({Square::E1, Square::G1});
-        if (whiteCastleQueenside && !((whitePawns|whiteKnights|whiteBishops|whiteRooks|whiteQueens|blackPawns|blackKnights|blackBishops|blackRooks|blackQueens|blackKing) & WHITE_QUEENSIDE_CASTLE_PATH))
-            moves.push_back({Square::E1, Square::C1});
-    } else if (blackKing & static_cast<uint64_t>(Square::E8)){
-        if (blackCastleKingside && !((whitePawns|whiteKnights|whiteBishops|whiteRooks|whiteQueens|whiteKing|blackPawns|blackKnights|blackBishops|blackRooks|blackQueens) & BLACK_KINGSIDE_CASTLE_PATH))
-            moves.push_back({Square::E8, Square::G8});
-        if (blackCastleQueenside && !((whitePawns|whiteKnights|whiteBishops|whiteRooks|whiteQueens|whiteKing|blackPawns|blackKnights|blackBishops|blackRooks|blackQueens) & BLACK_QUEENSIDE_CASTLE_PATH))
-            moves.push_back({Square::E8, Square::C8});
+}
+
+void Board::generateCaptures(MoveList& moves) {
+    generateLegalMoves(moves, MoveGenType::CAPTURES);
+}
+
+void Board::generateQuietChecks(MoveList& moves) {
+    generateLegalMoves(moves, MoveGenType::QUIET_CHECKS);
+}
+
+void Board::generateEvasions(MoveList& moves) {
+    generateLegalMoves(moves, MoveGenType::EVASIONS);
+}
+
+template <Color Us, MoveGenType Type>
+void Board::generateLegal(MoveList& moves) {
+    constexpr int us = Side<Us>::us;
+    uint64_t king = pieces[us][KING];
+    if (king == 0) {
+        // Without a king nothing can be illegal; filter the pseudo-legal moves by type.
+        if constexpr (Type == MoveGenType::EVASIONS) return;
+        generatePseudoLegal<Us>(moves);
+        if constexpr (Type != MoveGenType::ALL) {
+            size_t count = 0;
+            for (size_t i = 0; i < moves.size(); ++i) {
+                PackedMove move = moves[i];
+                bool capture = isCaptureMove(move) ||
+                    (move.kind() == PackedMove::PROMOTION && move.promotionPiece() == PieceType::QUEEN);
+                if (capture == (Type == MoveGenType::CAPTURES)) moves[count++] = move;
+            }
+            moves.resize(count);
+        }
+        return;
+    }
+
+    int kingSquare = getSquareIndex(king);
+    uint64_t friendlyPieces = colorOccupancy[us];
+    uint64_t enemyPieces = colorOccupancy[us ^ 1];
+    // Only look for the checkers once the attack map says there are some.
+    uint64_t checkers = (attackedBy<Side<Us>::them>() & king) ? attackersTo(kingSquare, occupancy) & enemyPieces : 0;
+    if constexpr (Type == MoveGenType::EVASIONS) {
+        if (!checkers) return;
+    }
+
+    // In double check only the king may move.
+    if (!(checkers & (checkers - 1))) {
+        // Otherwise non-king moves must capture the checker or block its ray.
+        uint64_t targets = ~friendlyPieces;
+        if (checkers) targets &= checkers | betweenBB(kingSquare, getSquareIndex(checkers));
+        uint64_t pinned = pinnedPieces<Us>();
+        // Pawns sort their moves by type themselves, since pushes can promote.
+        uint64_t pieceTargets = targets;
+        if constexpr (Type == MoveGenType::CAPTURES) pieceTargets &= enemyPieces;
+        if constexpr (Type == MoveGenType::QUIETS) pieceTargets &= ~enemyPieces;
+
+        generatePawnMoves<Us, Type>(moves, targets, pinned, true);
+        generatePieceMoves<Us, PieceType::KNIGHT>(moves, pieceTargets, pinned);
+        generatePieceMoves<Us, PieceType::BISHOP>(moves, pieceTargets, pinned);
+        generatePieceMoves<Us, PieceType::ROOK>(moves, pieceTargets, pinned);
+        generatePieceMoves<Us, PieceType::QUEEN>(moves, pieceTargets, pinned);
+    }
+    generateLegalKingMoves<Us, Type>(moves, checkers);
+}
+
+// Quiet moves that give check. Each piece's targets are cut down up front to
+// the squares it checks from, or, if it can uncover a check from one of our
+// sliders, to every square off that line.
+template <Color Us>
+void Board::generateQuietChecks(MoveList& moves) {
+    using S = Side<Us>;
+    constexpr int us = S::us;
+    uint64_t king = pieces[us][KING];
+    uint64_t enemyKing = pieces[us ^ 1][KING];
+    if (!king || !enemyKing) return;
+    int kingSquare = getSquareIndex(king);
+    int enemyKingSquare = getSquareIndex(enemyKing);
+    uint64_t enemyAttacks = attackedBy<S::them>();
+    if (enemyAttacks & king) return;
+
+    uint64_t empty = ~occupancy;
+    uint64_t pinned = pinnedPieces<Us>();
+    uint64_t discoverers = sliderBlockers(enemyKingSquare, us, us);
+    uint64_t bishopChecks = bishopAttacks(enemyKingSquare, occupancy);
+    uint64_t rookChecks = rookAttacks(enemyKingSquare, occupancy);
+
+    auto checkTargets = [&](int from, uint64_t direct) {
+        uint64_t targets = direct;
+        if (discoverers & (1ULL << from)) targets |= ~lineBB(enemyKingSquare, from);
+        if (pinned & (1ULL << from)) targets &= lineBB(kingSquare, from);
+        return targets & empty;
+    };
+    auto addMoves = [&](int from, uint64_t valid_moves) {
+        while (valid_moves) {
+            moves.push_back(PackedMove(from, getSquareIndex(valid_moves)));
+            valid_moves &= valid_moves - 1;
+        }
+    };
+
+    uint64_t pawns = pieces[us][PAWN];
+    while (pawns) {
+        int from = getSquareIndex(pawns);
+        pawns &= pawns - 1;
+        int to = from + S::forward;
+        if (occupancy & (1ULL << to)) continue;
+
+        if ((1ULL << to) & S::promotionRank) {
+            // Underpromotions: the new piece checks from its square, or the
+            // pawn uncovers a check by leaving the line.
+            if ((pinned & (1ULL << from)) && !(lineBB(kingSquare, from) & (1ULL << to))) continue;
+            bool discovered = (discoverers & (1ULL << from)) && !(lineBB(enemyKingSquare, from) & (1ULL << to));
+            uint64_t occupied = occupancy ^ (1ULL << from);
+            if (discovered || (KNIGHT_ATTACKS[to] & enemyKing)) moves.push_back(PackedMove(from, to, PackedMove::PROMOTION, PieceType::KNIGHT));
+            if (discovered || (rookAttacks(to, occupied) & enemyKing)) moves.push_back(PackedMove(from, to, PackedMove::PROMOTION, PieceType::ROOK));
+            if (discovered || (bishopAttacks(to, occupied) & enemyKing)) moves.push_back(PackedMove(from, to, PackedMove::PROMOTION, PieceType::BISHOP));
+            continue;
+        }
+
+        uint64_t targets = checkTargets(from, PAWN_ATTACKS[us ^ 1][enemyKingSquare]);
+        if (targets & (1ULL << to)) moves.push_back(PackedMove(from, to));
+        int doubleTo = to + S::forward;
+        if (((1ULL << from) & S::doublePushFrom) && (targets & empty & (1ULL << doubleTo))) {
+            moves.push_back(PackedMove(from, doubleTo));
+        }
+    }
+
+    for (uint64_t knights = pieces[us][KNIGHT]; knights; knights &= knights - 1) {
+        int from = getSquareIndex(knights);
+        addMoves(from, KNIGHT_ATTACKS[from] & checkTargets(from, KNIGHT_ATTACKS[enemyKingSquare]));
+    }
+    for (uint64_t bishops = pieces[us][BISHOP]; bishops; bishops &= bishops - 1) {
+        int from = getSquareIndex(bishops);
+        addMoves(from, bishopAttacks(from, occupancy) & checkTargets(from, bishopChecks));
+    }
+    for (uint64_t rooks = pieces[us][ROOK]; rooks; rooks &= rooks - 1) {
+        int from = getSquareIndex(rooks);
+        addMoves(from, rookAttacks(from, occupancy) & checkTargets(from, rookChecks));
+    }
+    for (uint64_t queens = pieces[us][QUEEN]; queens; queens &= queens - 1) {
+        int from = getSquareIndex(queens);
+        addMoves(from, queenAttacks(from, occupancy) & checkTargets(from, bishopChecks | rookChecks));
+    }
+
+    // The king only checks by discovery, and must not step into an attack.
+    if (discoverers & king) {
+        uint64_t valid_moves = KING_ATTACKS[kingSquare] & empty & ~lineBB(enemyKingSquare, kingSquare);
+        while (valid_moves) {
+            int to = getSquareIndex(valid_moves);
+            if (!(enemyAttacks & (1ULL << to))) moves.push_back(PackedMove(kingSquare, to));
+            valid_moves &= valid_moves - 1;
+        }
+    }
+
+    // Castling checks with the rook. There are at most two castling moves,
+    // so reuse the king generator for their legality and test each one.
+    if (kingSquare == S::kingHome) {
+        MoveList kingMoves;
+        generateLegalKingMoves<Us, MoveGenType::QUIETS>(kingMoves, 0);
+        for (PackedMove move : kingMoves) {
+            if (move.kind() != PackedMove::CASTLING) continue;
+            bool kingside = move.to() > move.from();
+            int rookFrom = kingside ? S::kingHome + 3 : S::kingHome - 4;
+            int rookTo = kingside ? S::kingHome + 1 : S::kingHome - 1;
+            uint64_t occupied = (occupancy ^ king ^ (1ULL << rookFrom)) | (1ULL << move.to()) | (1ULL << rookTo);
+            if (rookAttacks(rookTo, occupied) & enemyKing) moves.push_back(move);
+        }
     }
-    return moves;
 }
 
 /**
@@ -1012,50 +1493,198 @@ std::vector<Move> Board::generateKingMoves() {
  * @return A vector of valid Move structs.
  */
 std::vector<Move> Board::generateLegalMoves() {
-    std::vector<Move> pseudoLegalMoves = generatePseudoLegalMoves();
+    MoveList moves;
+    generateLegalMoves(moves);
+    std::vector<Move> result;
+    for (PackedMove move : moves) result.push_back(move.toMove());
+    return result;
+}
 
-    std::vector<Move> legalMoves;
-    for (const Move& move : pseudoLegalMoves) {
-        if (this->isMoveLegal(move)) {
-            legalMoves.push_back(move);
-        } else {
-            // std::cout << "pseudo legal move illegal: " << toAlgebraicNotation(move.start) << " -> " << toAlgebraicNotation(move.end)<< std::endl;
-        }
+bool Board::isMoveLegal(PackedMove move) {
+    Color mover = this->sideToMove;
+    UndoInfo undo;
+    if (!doMove(move, undo)) {
+        return false;
     }
-    
-    return legalMoves;
-}
 
-bool Board::isMoveLegal(Move move) {
-    Board tempBoard = *this;
+    bool leavesKingInCheck = isKingInCheck(mover);
+    undoMove(undo);
+    return !leavesKingInCheck;
+}
 
-    if (!tempBoard.applyMove(move)) {
+bool Board::isLegal(PackedMove move) {
+    Piece piece = pieceAt[move.from()];
+    if (move.from() == move.to() || piece == Piece::NO_PIECE || pieceColorOf(piece) != sideToMove) {
         return false;
     }
 
-    if (tempBoard.isKingInCheck(this->sideToMove)) {
-        // std::cout << "move leaves king in check" << std::endl;
-        return false;
+    // The kind must be the one the generator would have given this move,
+    // since applyMove is lenient and would accept e.g. a stale promotion flag.
+    PackedMove::Kind expected = PackedMove::NORMAL;
+    uint64_t end_bit = 1ULL << move.to();
+    if (pieceTypeOf(piece) == PieceType::PAWN) {
+        if (end_bit & (Side<Color::WHITE>::promotionRank | Side<Color::BLACK>::promotionRank)) expected = PackedMove::PROMOTION;
+        else if (end_bit == enPassent) expected = PackedMove::EN_PASSANT;
+    } else if (pieceTypeOf(piece) == PieceType::KING && std::abs(move.to() - move.from()) == 2) {
+        expected = PackedMove::CASTLING;
     }
+    if (move.kind() != expected) return false;
+    if (expected != PackedMove::PROMOTION && move.promotionPiece() != PieceType::QUEEN) return false;
 
-    return true;
+    return isMoveLegal(move);
+}
+
+bool Board::isCaptureMove(PackedMove move) {
+    if (move.kind() == PackedMove::EN_PASSANT) {
+        return true;
+    }
+
+    // Check for a regular capture
+    Piece target = pieceAt[move.to()];
+    return target != Piece::NO_PIECE && pieceColorOf(target) != sideToMove;
 }
 
 bool Board::isCaptureMove(const Move& move) {
+    return isCaptureMove(encodeMove(move));
+}
+
+// Piece values for exchange evaluation, indexed by PieceType. The king never
+// has to be valued: it only captures when nothing can take it back.
+constexpr int SEE_VALUES[6] = { 900, 500, 320, 330, 100, 0 };
+
+// Sets up an exchange: the value of what the move takes and of the piece then
+// standing on the destination. Returns the occupancy after the move.
+uint64_t Board::exchangeStart(PackedMove move, int& gain, int& attackerValue) {
+    uint64_t occupied = occupancy ^ (1ULL << move.from());
+    Piece victim = pieceAt[move.to()];
+    gain = victim == Piece::NO_PIECE ? 0 : SEE_VALUES[static_cast<int>(pieceTypeOf(victim))];
+    attackerValue = SEE_VALUES[static_cast<int>(pieceTypeOf(pieceAt[move.from()]))];
+    if (move.kind() == PackedMove::EN_PASSANT) {
+        gain = SEE_VALUES[PAWN];
+        occupied ^= 1ULL << (move.to() ^ 8);
+    } else if (move.kind() == PackedMove::PROMOTION) {
+        attackerValue = SEE_VALUES[static_cast<int>(move.promotionPiece())];
+        gain += attackerValue - SEE_VALUES[PAWN];
+    }
+    return occupied;
+}
+
+// The cheapest of the color's pieces among the attackers, as a single bit.
+uint64_t Board::leastValuableAttacker(uint64_t attackers, int color, PieceType& type) {
+    static constexpr PieceType ORDER[6] = { PieceType::PAWN, PieceType::KNIGHT, PieceType::BISHOP,
+                                            PieceType::ROOK, PieceType::QUEEN, PieceType::KING };
+    for (PieceType candidate : ORDER) {
+        uint64_t found = attackers & pieces[color][static_cast<int>(candidate)];
+        if (found) {
+            type = candidate;
+            return found & -found;
+        }
+    }
+    return 0;
+}
+
+int Board::see(const Move& move) {
+    return see(encodeMove(move));
+}
+
+int Board::see(PackedMove move) {
+    if (move.kind() == PackedMove::CASTLING) return 0;
+    int to = move.to();
+    int side = static_cast<int>(pieceColorOf(pieceAt[move.from()]));
+    uint64_t rookLike = pieces[WHITE][ROOK] | pieces[BLACK][ROOK] | pieces[WHITE][QUEEN] | pieces[BLACK][QUEEN];
+    uint64_t bishopLike = pieces[WHITE][BISHOP] | pieces[BLACK][BISHOP] | pieces[WHITE][QUEEN] | pieces[BLACK][QUEEN];
+
+    // gain[d] is the balance for the side making capture d if it is made.
+    int gain[32];
+    int attackerValue;
+    int depth = 0;
+    uint64_t occupied = exchangeStart(move, gain[0], attackerValue);
+    uint64_t attackers = attackersTo(to, occupied) & occupied;
+    while (true) {
+        side ^= 1;
+        ++depth;
+        gain[depth] = attackerValue - gain[depth - 1];
+
+        PieceType type;
+        uint64_t from = leastValuableAttacker(attackers, side, type);
+        if (!from) break;
+        // The king may only capture last.
+        if (type == PieceType::KING && (attackers & colorOccupancy[side ^ 1])) break;
+
+        occupied ^= from;
+        if (type == PieceType::PAWN || type == PieceType::BISHOP || type == PieceType::QUEEN)
+            attackers |= bishopAttacks(to, occupied) & bishopLike;
+        if (type == PieceType::ROOK || type == PieceType::QUEEN)
+            attackers |= rookAttacks(to, occupied) & rookLike;
+        attackers &= occupied;
+        attackerValue = SEE_VALUES[static_cast<int>(type)];
+    }
+    while (--depth) gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+    return gain[0];
+}
+
+bool Board::seeGE(const Move& move, int threshold) {
+    return seeGE(encodeMove(move), threshold);
+}
+
+bool Board::seeGE(PackedMove move, int threshold) {
+    if (move.kind() == PackedMove::CASTLING) return threshold <= 0;
+    int to = move.to();
+    int side = static_cast<int>(pieceColorOf(pieceAt[move.from()]));
+    uint64_t rookLike = pieces[WHITE][ROOK] | pieces[BLACK][ROOK] | pieces[WHITE][QUEEN] | pieces[BLACK][QUEEN];
+    uint64_t bishopLike = pieces[WHITE][BISHOP] | pieces[BLACK][BISHOP] | pieces[WHITE][QUEEN] | pieces[BLACK][QUEEN];
+
+    int gain, attackerValue;
+    uint64_t occupied = exchangeStart(move, gain, attackerValue);
+    // Balance relative to the threshold with the mover's piece still en prise.
+    int swap = gain - threshold;
+    if (swap < 0) return false;
+    swap = attackerValue - swap;
+    if (swap <= 0) return true;
+
+    uint64_t attackers = attackersTo(to, occupied) & occupied;
+    // result is 1 while the mover is ahead of the threshold.
+    int result = 1;
+    while (true) {
+        side ^= 1;
+        attackers &= occupied;
+        PieceType type;
+        uint64_t from = leastValuableAttacker(attackers, side, type);
+        if (!from) break;
+        // A king capture only stands if the other side has nothing left.
+        if (type == PieceType::KING) return (attackers & colorOccupancy[side ^ 1]) ? result : result ^ 1;
+
+        result ^= 1;
+        swap = SEE_VALUES[static_cast<int>(type)] - swap;
+        if (swap < result) break;
+
+        occupied ^= from;
+        if (type == PieceType::PAWN || type == PieceType::BISHOP || type == PieceType::QUEEN)
+            attackers |= bishopAttacks(to, occupied) & bishopLike;
+        if (type == PieceType::ROOK || type == PieceType::QUEEN)
+            attackers |= rookAttacks(to, occupied) & rookLike;
+    }
+    return result;
+}
+
+PackedMove Board::encodeMove(const Move& move) {
     uint64_t start_bit = static_cast<uint64_t>(move.start);
     uint64_t end_bit = static_cast<uint64_t>(move.end);
-
-    // Check for en passant capture
-    if ((start_bit & (whitePawns | blackPawns)) && (end_bit == enPassent)) {
-        return true;
+    int from = getSquareIndex(start_bit);
+    int to = getSquareIndex(end_bit);
+    if (from == 64 || to == 64) {
+        return PackedMove();
     }
 
-    // Check for a regular capture
-    if (sideToMove == Color::WHITE) {
-        return (end_bit & (blackPawns|blackRooks|blackBishops|blackQueens|blackKnights));
-    } else {
-        return (end_bit & (whitePawns|whiteRooks|whiteBishops|whiteQueens|whiteKnights));
+    PackedMove::Kind kind = PackedMove::NORMAL;
+    Piece moving = pieceAt[from];
+    if (moving == Piece::WHITE_KING || moving == Piece::BLACK_KING) {
+        if (std::abs((from & 7) - (to & 7)) == 2) kind = PackedMove::CASTLING;
+    } else if (moving == Piece::WHITE_PAWN || moving == Piece::BLACK_PAWN) {
+        if (enPassent && end_bit == enPassent) kind = PackedMove::EN_PASSANT;
+        else if (end_bit & 0xFF000000000000FFULL) kind = PackedMove::PROMOTION;
     }
+    return PackedMove(from, to, kind, move.promotionPiece);
 }
 
 // BoardBuilder class implementations
@@ -1142,7 +1771,10 @@ BoardBuilder& BoardBuilder::setWhiteCastleKingside(bool canCastle) { board->setW
 BoardBuilder& BoardBuilder::setWhiteCastleQueenside(bool canCastle) { board->setWhiteCastleQueenside(canCastle); return *this; }
 BoardBuilder& BoardBuilder::setEnPassent(uint64_t enPassent) { board->setEnPassent(enPassent); return *this; }
 
-std::unique_ptr<Board> BoardBuilder::Build() { return std::move(board); }
+std::unique_ptr<Board> BoardBuilder::Build() {
+    board->hashKey = board->computeHash();
+    return std::move(board);
+}
 
 std::unique_ptr<Board> StandardBoard() {
     BoardBuilder boardBuilder(Square::E8, Square::E1, Color::WHITE);
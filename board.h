@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <memory>
 #include <vector>
 #include <cmath>
@@ -29,8 +30,29 @@ enum class Square : uint64_t {
 // Converts a Square enum value to its algebraic notation string.
 std::string toAlgebraicNotation(Square square);
 
-// Enum to represent the type of piece a pawn can promote to.
-enum class PieceType { QUEEN, ROOK, KNIGHT, BISHOP };
+// Enum to represent the type of a piece. The first four values are the
+// pieces a pawn can promote to.
+enum class PieceType { QUEEN, ROOK, KNIGHT, BISHOP, PAWN, KING };
+
+// A piece together with its color, as stored in the board's square mailbox.
+// Values are color * 6 + piece type; NO_PIECE marks an empty square.
+enum class Piece : uint8_t {
+    WHITE_QUEEN, WHITE_ROOK, WHITE_KNIGHT, WHITE_BISHOP, WHITE_PAWN, WHITE_KING,
+    BLACK_QUEEN, BLACK_ROOK, BLACK_KNIGHT, BLACK_BISHOP, BLACK_PAWN, BLACK_KING,
+    NO_PIECE
+};
+
+constexpr Piece makePiece(Color color, PieceType type) {
+    return static_cast<Piece>(static_cast<int>(color) * 6 + static_cast<int>(type));
+}
+
+constexpr PieceType pieceTypeOf(Piece piece) {
+    return static_cast<PieceType>(static_cast<int>(piece) % 6);
+}
+
+constexpr Color pieceColorOf(Piece piece) {
+    return static_cast<Color>(static_cast<int>(piece) / 6);
+}
 
 class Move {
 public:
@@ -39,6 +61,77 @@ public:
     PieceType promotionPiece = PieceType::QUEEN;
 };
 
+// Compact 16-bit move used by move generation and search. Bits 0-5 hold the
+// start square index, bits 6-11 the end square index, bits 12-13 the
+// promotion piece and bits 14-15 the kind of move.
+class PackedMove {
+public:
+    enum Kind : uint16_t { NORMAL = 0, PROMOTION = 1, EN_PASSANT = 2, CASTLING = 3 };
+
+    constexpr PackedMove() : data(0) {}
+    constexpr PackedMove(int from, int to, Kind kind = NORMAL, PieceType promotion = PieceType::QUEEN)
+        : data(static_cast<uint16_t>(from | (to << 6) | (static_cast<int>(promotion) << 12) | (kind << 14))) {}
+
+    constexpr int from() const { return data & 0x3F; }
+    constexpr int to() const { return (data >> 6) & 0x3F; }
+    constexpr Kind kind() const { return static_cast<Kind>(data >> 14); }
+    constexpr PieceType promotionPiece() const { return static_cast<PieceType>((data >> 12) & 3); }
+    constexpr uint16_t raw() const { return data; }
+
+    // Converts to the square-based Move used by the players and tests. Use
+    // Board::encodeMove for the other direction, since the kind depends on the position.
+    Move toMove() const {
+        return {static_cast<Square>(1ULL << from()), static_cast<Square>(1ULL << to()), promotionPiece()};
+    }
+
+    constexpr bool operator==(const PackedMove& other) const { return data == other.data; }
+    constexpr bool operator!=(const PackedMove& other) const { return data != other.data; }
+
+private:
+    uint16_t data;
+};
+
+static_assert(sizeof(PackedMove) == 2, "PackedMove must stay 16 bits");
+
+// Converts a move to UCI long algebraic notation, e.g. "e2e4" or "e7e8q".
+std::string toUCINotation(PackedMove move);
+
+// Fixed-capacity list of packed moves with inline storage, so move generation never
+// touches the heap. No legal chess position has more than 218 moves.
+class MoveList {
+public:
+    static constexpr size_t CAPACITY = 256;
+
+    void push_back(PackedMove move) { moves[count++] = move; }
+    void clear() { count = 0; }
+    void resize(size_t size) { count = size; }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    PackedMove& operator[](size_t index) { return moves[index]; }
+    const PackedMove& operator[](size_t index) const { return moves[index]; }
+
+    PackedMove* data() { return moves; }
+    const PackedMove* data() const { return moves; }
+    PackedMove* begin() { return moves; }
+    PackedMove* end() { return moves + count; }
+    const PackedMove* begin() const { return moves; }
+    const PackedMove* end() const { return moves + count; }
+
+private:
+    PackedMove moves[CAPACITY];
+    size_t count = 0;
+};
+
+// Which subset of the legal moves a generator call produces. CAPTURES holds
+// captures (including every promotion that captures), en passant and queen
+// promotions; QUIETS holds everything else, including castling and the
+// underpromotions of a pawn push. EVASIONS is every legal move when in check
+// and nothing otherwise; QUIET_CHECKS is the QUIETS moves that give check,
+// and nothing when already in check.
+enum class MoveGenType { ALL, CAPTURES, QUIETS, EVASIONS, QUIET_CHECKS };
+
 // --- Operator Overloads for Square ---
 
 // Bitwise OR
@@ -55,14 +148,52 @@ inline uint64_t operator&(Square a, Square b) {
 
 std::string pieceTypeToString(PieceType piece);
 
+// Everything Board::undoMove needs to take back a move made with Board::doMove.
+struct UndoInfo {
+    PackedMove move;
+    PieceType movedPiece;
+    bool isCapture;
+    PieceType capturedPiece;
+    uint64_t capturedSquare;
+
+    bool blackCastleKingside;
+    bool blackCastleQueenside;
+    bool whiteCastleKingside;
+    bool whiteCastleQueenside;
+
+    uint64_t enPassent;
+    uint64_t hash;
+    int halfmoveClock;
+};
+
 class Board {
 public:
     Board();
     Board(const Board& other);
+    Board& operator=(const Board& other);
+
+    // Builds a board from a FEN string; nullptr if it is malformed. The move
+    // counters are optional and default to 0 and 1.
+    static std::unique_ptr<Board> fromFEN(std::string_view fen);
+    // Replaces the position in place. Returns false, leaving the board
+    // untouched, if the FEN is malformed. Does not allocate.
+    bool setFromFEN(std::string_view fen);
+    std::string toFEN() const;
     
     // Public member functions
     std::string toString() const;
     bool makeMove(Move move);
+    bool makeMove(PackedMove move);
+
+    // Applies a move in place and records what is needed to take it back.
+    // Returns false, leaving the board untouched, if the move is invalid.
+    // The move may still leave the mover's king in check.
+    bool doMove(PackedMove move, UndoInfo& undo);
+    bool doMove(Move move, UndoInfo& undo);
+    void undoMove(const UndoInfo& undo);
+
+    // Packs a Move, deriving its kind (castling, en passant, promotion) from the position.
+    PackedMove encodeMove(const Move& move);
 
     // Setter methods
     void setBlackBishops(uint64_t squares);
@@ -87,6 +218,8 @@ public:
     void setEnPassent(uint64_t square);
 
     void setSideToMove(Color sideToMove);
+    void setHalfmoveClock(int halfmoveClock);
+    void setFullmoveNumber(int fullmoveNumber);
 
     // Getter methods
     uint64_t getBlackBishops();
@@ -124,43 +257,126 @@ public:
 
     Color getSideToMove();
 
+    // Plies since the last capture or pawn move, and the move number, which
+    // starts at 1 and goes up after each black move.
+    int getHalfmoveClock() const;
+    int getFullmoveNumber() const;
+
+    // Draw detection from the keys of the positions played so far. A
+    // repetition can only reach back to the last capture or pawn move, so
+    // these scan at most halfmoveClock keys, two at a time.
+    // isRepetition is true if the position occurred before and is what the
+    // search should treat as a draw; isThreefoldRepetition needs two earlier
+    // occurrences. isFiftyMoveDraw is the fifty-move rule, unless the last
+    // move gave checkmate.
+    bool isRepetition() const;
+    bool isThreefoldRepetition() const;
+    bool isFiftyMoveDraw();
+
+    // Piece on a square, looked up in constant time; NO_PIECE if it is empty.
+    Piece pieceOn(Square square) const;
+    Piece pieceOn(int square) const;
+
+    // True if any of the squares is attacked by the given color. The other
+    // color's king does not block, so squares behind a checked king count as
+    // attacked. Answered from the cached attack map.
     bool areSquaresAttacked(uint64_t squares, Color kingColor);
+    // Move generation writes into a caller-provided list. The vector-returning
+    // overloads are conveniences for code outside the search.
+    void generateLegalMoves(MoveList& moves);
+    // Generates only the given subset; the legacy flag applies to ALL only.
+    void generateLegalMoves(MoveList& moves, MoveGenType type);
+    void generateCaptures(MoveList& moves);
+    void generateQuietChecks(MoveList& moves);
+    void generateEvasions(MoveList& moves);
+    void generatePseudoLegalMoves(MoveList& moves);
     std::vector<Move> generateLegalMoves();
     std::vector<Move> generatePseudoLegalMoves();
     bool isKingInCheckmate(Color kingColor);
     bool isKingInCheck(Color kingColor);
     bool isInsufficientMaterial();
     void setVerbose(bool verbose);
+    // Switches generateLegalMoves back to filtering pseudo-legal moves one
+    // by one, so the pin-aware generator can be cross-checked against it.
+    void setLegacyMoveGeneration(bool legacy);
+    // True if the move is valid and does not leave the mover's king in
+    // check. Used to vet moves from outside the generator, e.g. a hash move.
+    bool isLegal(PackedMove move);
+    bool isCaptureMove(PackedMove move);
     bool isCaptureMove(const Move& move);
+
+    // Static exchange evaluation: what the mover gains, in centipawns, if both
+    // sides keep recapturing on the destination with their least valuable
+    // piece, each free to stop when recapturing would lose. Sliders uncovered
+    // behind a capturer join in. Pins are ignored.
+    int see(PackedMove move);
+    int see(const Move& move);
+    // True if see(move) >= threshold, deciding as soon as the exchange can no
+    // longer cross the threshold instead of playing it out.
+    bool seeGE(PackedMove move, int threshold);
+    bool seeGE(const Move& move, int threshold);
+
+    // Zobrist key of the position, maintained incrementally as moves are made.
+    uint64_t hash() const;
+    // Recomputes the Zobrist key from scratch.
+    uint64_t computeHash() const;
 private:
+    friend class BoardBuilder;
+
     // Internal helper functions
-    bool applyMove(Move move);
+    // Runtime dispatch to the color-specialized version below.
+    bool applyMove(PackedMove move);
+    template <Color Us> bool applyMove(PackedMove move);
+    template <Color Them> bool areSquaresAttacked(uint64_t squares);
+    template <Color Them> uint64_t attackedBy();
+    void updateCastlingRights(uint64_t start_bit, uint64_t end_bit);
+    void updateEnPassent(uint64_t square);
+    void addPiece(Color color, PieceType piece, uint64_t square);
+    void removePiece(Color color, PieceType piece, uint64_t square);
+    void movePiece(Color color, PieceType piece, uint64_t from, uint64_t to);
+    uint64_t pieceBitboard(Color color, PieceType piece) const {
+        return pieces[static_cast<int>(color)][static_cast<int>(piece)];
+    }
+    bool findPiece(Color color, uint64_t square, PieceType& piece);
+    void setPieces(Color color, PieceType piece, uint64_t squares);
     bool isPathClear(uint64_t start_bit, uint64_t end_bit, uint64_t allPieces);
     uint64_t getPawnAttacks(Color side, uint64_t pawns);
     uint64_t getKnightAttacks(uint64_t knights);
     uint64_t getKingAttacks(uint64_t king);
-    uint64_t getSlidingAttacks(uint64_t pieces, uint64_t allPieces, bool isRook);
-    std::vector<Move> generatePawnMoves();
-    std::vector<Move> generateKnightMoves();
-    std::vector<Move> generateBishopMoves();
-    std::vector<Move> generateRookMoves();
-    std::vector<Move> generateQueenMoves();
-    std::vector<Move> generateKingMoves();
-    bool isMoveLegal(Move move);
+    // Color-specialized generators, selected once per call by generateLegalMoves
+    // and generatePseudoLegalMoves. Piece generators only emit moves landing on
+    // targets; pinned pieces are further restricted to the line through their king.
+    template <Color Us, MoveGenType Type> void generateLegal(MoveList& moves);
+    template <Color Us> void generatePseudoLegal(MoveList& moves);
+    template <Color Us, MoveGenType Type> void generatePawnMoves(MoveList& moves, uint64_t targets, uint64_t pinned, bool legal);
+    template <Color Us, PieceType Type> void generatePieceMoves(MoveList& moves, uint64_t targets, uint64_t pinned);
+    template <Color Us> void generateKingMoves(MoveList& moves);
+    template <Color Us, MoveGenType Type> void generateLegalKingMoves(MoveList& moves, uint64_t checkers);
+    template <Color Us> void generateQuietChecks(MoveList& moves);
+    template <Color Us> uint64_t pinnedPieces();
+    uint64_t sliderBlockers(int square, int sliderColor, int blockerColor);
+    template <Color Us> bool isEnPassentLegal(int from);
+    uint64_t attackersTo(int square, uint64_t occupied);
+    int kingSquareIndex(Color color);
+    bool isMoveLegal(PackedMove move);
+    uint64_t exchangeStart(PackedMove move, int& gain, int& attackerValue);
+    uint64_t leastValuableAttacker(uint64_t attackers, int color, PieceType& type);
     
     // Private member variables (bitboards and state flags)
-    uint64_t blackBishops;
-    uint64_t blackKing;
-    uint64_t blackKnights;
-    uint64_t blackPawns;
-    uint64_t blackQueens;
-    uint64_t blackRooks;
-    uint64_t whiteBishops;
-    uint64_t whiteKing;
-    uint64_t whiteKnights;
-    uint64_t whitePawns;
-    uint64_t whiteQueens;
-    uint64_t whiteRooks;
+    // Bitboards indexed by [Color][PieceType], with each color's occupancy and
+    // the total occupancy kept in step by addPiece/removePiece/movePiece.
+    uint64_t pieces[2][6];
+    uint64_t colorOccupancy[2];
+    uint64_t occupancy;
+
+    // Squares attacked by each color, with the other color's king lifted off
+    // the board. Built on first use and dropped whenever a piece is placed,
+    // removed or moved, so it is shared by every query on one position.
+    uint64_t attackMap[2];
+    bool attackMapValid[2];
+
+    // Mailbox mirror of the bitboards, indexed by square.
+    Piece pieceAt[64];
 
     bool blackCastleKingside;
     bool blackCastleQueenside;
@@ -168,9 +384,25 @@ private:
     bool whiteCastleQueenside;
 
     bool verbose;
+    bool legacyMoveGeneration;
 
     uint64_t enPassent;
     Color sideToMove;
+    int halfmoveClock;
+    int fullmoveNumber;
+
+    uint64_t hashKey;
+
+    // Keys of the positions before each move made with doMove, indexed by
+    // ply modulo the capacity, so making a move never allocates. Lookups
+    // reach back at most half the capacity, which a line searched forward
+    // from the current position can never wrap around to overwrite. Left
+    // uninitialised: gamePly bounds every read to slots already written.
+    static constexpr int KEY_HISTORY_SIZE = 1024;
+    uint64_t keyHistory[KEY_HISTORY_SIZE];
+    int gamePly;
+
+    int repetitions(int limit) const;
 };
 
 class BoardBuilder {
@@ -0,0 +1,107 @@
+#include "epd.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+namespace {
+
+constexpr size_t BUFFER_SIZE = 1 << 16;
+constexpr std::string_view WHITESPACE = " \t\r";
+
+std::string_view trim(std::string_view text) {
+    size_t start = text.find_first_not_of(WHITESPACE);
+    if (start == std::string_view::npos) return {};
+    size_t end = text.find_last_not_of(WHITESPACE);
+    return text.substr(start, end - start + 1);
+}
+
+bool isNumber(std::string_view field) {
+    return !field.empty() && std::all_of(field.begin(), field.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+// Splits a line into the FEN part and the operations, then loads the FEN.
+bool parseLine(Board& board, std::string_view line, std::string_view& operations) {
+    line = trim(line);
+    if (line.empty() || line.front() == '#') return false;
+
+    // Returns the end of the field starting at or after pos.
+    auto fieldEnd = [&line](size_t pos) {
+        size_t start = line.find_first_not_of(WHITESPACE, pos);
+        if (start == std::string_view::npos) return std::string_view::npos;
+        return std::min(line.find_first_of(WHITESPACE, start), line.size());
+    };
+
+    size_t end = 0;
+    for (int field = 0; field < 4; ++field) {
+        end = fieldEnd(end);
+        if (end == std::string_view::npos) return false;
+    }
+
+    // Some files keep the FEN move counters in front of the operations.
+    size_t halfmoveEnd = fieldEnd(end);
+    if (halfmoveEnd != std::string_view::npos && isNumber(trim(line.substr(end, halfmoveEnd - end)))) {
+        size_t fullmoveEnd = fieldEnd(halfmoveEnd);
+        if (fullmoveEnd != std::string_view::npos && isNumber(trim(line.substr(halfmoveEnd, fullmoveEnd - halfmoveEnd)))) {
+            end = fullmoveEnd;
+        }
+    }
+
+    if (!board.setFromFEN(line.substr(0, end))) return false;
+    operations = trim(line.substr(end));
+    return true;
+}
+
+} // namespace
+
+size_t readEPD(std::istream& input, const EPDCallback& callback) {
+    std::unique_ptr<char[]> buffer(new char[BUFFER_SIZE]);
+    Board board;
+    size_t count = 0;
+    size_t used = 0;
+    // Set while discarding the rest of a line too long for the buffer.
+    bool skipping = false;
+
+    auto handleLine = [&](std::string_view line) {
+        std::string_view operations;
+        if (parseLine(board, line, operations)) {
+            callback(board, operations);
+            ++count;
+        }
+    };
+
+    while (true) {
+        input.read(buffer.get() + used, BUFFER_SIZE - used);
+        size_t filled = used + static_cast<size_t>(input.gcount());
+        bool done = !input;
+
+        size_t start = 0;
+        while (const char* newline = static_cast<const char*>(std::memchr(buffer.get() + start, '\n', filled - start))) {
+            size_t end = newline - buffer.get();
+            if (!skipping) handleLine(std::string_view(buffer.get() + start, end - start));
+            skipping = false;
+            start = end + 1;
+        }
+
+        if (done) {
+            if (!skipping && start < filled) handleLine(std::string_view(buffer.get() + start, filled - start));
+            break;
+        }
+        if (start == 0 && filled == BUFFER_SIZE) {
+            // No line break in a full buffer: drop the line.
+            skipping = true;
+            used = 0;
+            continue;
+        }
+        // Keep the partial last line and read on behind it.
+        used = filled - start;
+        std::memmove(buffer.get(), buffer.get() + start, used);
+    }
+    return count;
+}
+
+size_t readEPDFile(const std::string& path, const EPDCallback& callback) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) return 0;
+    return readEPD(input, callback);
+}
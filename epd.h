@@ -0,0 +1,23 @@
+#ifndef EPD_H
+#define EPD_H
+
+#include "board.h"
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <string>
+#include <string_view>
+
+// Called once per position with the board and the operations that followed
+// it on the line, e.g. "bm Nf3; id \"WAC.001\";". The board is reused for
+// the next line, so copy it if it has to outlive the call.
+using EPDCallback = std::function<void(Board& board, std::string_view operations)>;
+
+// Streams EPD lines through one fixed buffer and one Board, so nothing is
+// allocated per line. FEN move counters after the four position fields are
+// accepted. Blank lines, '#' comments and malformed lines are skipped.
+// Returns the number of positions passed to the callback.
+size_t readEPD(std::istream& input, const EPDCallback& callback);
+size_t readEPDFile(const std::string& path, const EPDCallback& callback);
+
+#endif // EPD_H
@@ -4,13 +4,16 @@
 #include <stdexcept>
 #include <cmath> // For std::abs
 #include <vector> // For bitboard to index conversion
+#include <chrono>
 #include "board.h"
 #include "player.h"
 
 int main() {
     std::unique_ptr<Board> board = StandardBoard();
 
-    MinMaxPlayer whitePlayer(6);
+    // Five minutes plus two seconds a move; the depth is only a ceiling.
+    MinMaxPlayer whitePlayer(64);
+    whitePlayer.setTimeControl(std::chrono::minutes(5), std::chrono::seconds(2));
     HumanPlayer blackPlayer;
 
     std::cout << "Board:" << std::endl;
@@ -52,6 +55,14 @@ int main() {
             std::cout << "Insufficient Material! Game is a draw." << std::endl;
             break;
         }
+        if (board->isThreefoldRepetition()) {
+            std::cout << "Threefold Repetition! Game is a draw." << std::endl;
+            break;
+        }
+        if (board->isFiftyMoveDraw()) {
+            std::cout << "Fifty-Move Rule! Game is a draw." << std::endl;
+            break;
+        }
     }
 
     return 0;
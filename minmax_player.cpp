@@ -1,9 +1,12 @@
 #include "player.h"
+#include "move_picker.h"
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <cstdlib>
+#include <limits>
 
-MinMaxPlayer::MinMaxPlayer(int depth) : searchDepth(depth) {}
+MinMaxPlayer::MinMaxPlayer(int depth, size_t hashMegabytes) : searchDepth(depth), table(hashMegabytes) {}
 
 const int white_pawn_pst[64] = {
     0,  0,  0,  0,  0,  0,  0,  0,
@@ -115,6 +118,24 @@ const int black_king_mid_pst[64] = {
     -30,-40,-40,-50,-50,-40,-40,-30,
 };
 
+// Piece values on the evaluate scale, indexed by PieceType, for delta pruning.
+const int delta_piece_values[6] = { 9000, 5000, 3200, 3300, 1000, 0 };
+
+// Slack on top of the captured piece before a capture is ruled out, covering
+// positional swings the material count does not see.
+const int DELTA_MARGIN = 2000;
+
+// Scores are bounded by +-INFINITE_SCORE, which is also what a mate scores.
+const int INFINITE_SCORE = std::numeric_limits<int>::max();
+
+// Half-width of the first aspiration window, a quarter of a pawn. Once a
+// widened window would exceed the maximum the search gives up on it.
+const int ASPIRATION_WINDOW = 250;
+const int MAX_ASPIRATION_WINDOW = 4000;
+
+// History scores are halved once one passes this, well clear of overflow.
+const int HISTORY_LIMIT = 1 << 20;
+
 int MinMaxPlayer::evaluate(Board& board) {
     int score = 0;
 
@@ -233,121 +254,329 @@ int MinMaxPlayer::evaluate(Board& board) {
     return score;
 }
 
-int MinMaxPlayer::minimax(Board& board, int depth, int alpha, int beta) {
+// Captures and queen promotions are ordered by the picker's earlier stages;
+// killers and history only concern the rest.
+static bool isQuiet(Board& board, PackedMove move) {
+    return !board.isCaptureMove(move) &&
+           !(move.kind() == PackedMove::PROMOTION && move.promotionPiece() == PieceType::QUEEN);
+}
+
+// Negamax: every score is from the point of view of the side to move, so a
+// child's score is negated on the way back up and one loop serves both colors.
+int MinMaxPlayer::negamax(Board& board, int depth, int ply, int alpha, int beta) {
+    // A repeated position is scored as a draw the first time it recurs, since
+    // whatever led back to it can be played again.
+    if (board.isRepetition() || board.isFiftyMoveDraw()) {
+        return 0;
+    }
+
+    // Reading the clock every node would cost more than it saves; once the
+    // hard limit passes, every frame unwinds and the iteration is discarded.
+    if (timed && (++nodes & 1023) == 0 && Clock::now() >= hardDeadline) {
+        stopped = true;
+    }
+    if (stopped) {
+        return 0;
+    }
+
     if (depth == 0) {
-        int score = evaluate(board);
-        // std::cout << "score of board at depth " << depth << " is " << score << std::endl; 
-        // std::cout << board.toString() << std::endl;
-        return score;
+        return quiescence(board, alpha, beta);
     }
-    
+
+    // A stored result deep enough to settle this window ends the search here;
+    // otherwise its move is still the best guess to try first.
+    TTEntry entry;
+    PackedMove hashMove;
+    if (table.probe(board.hash(), entry)) {
+        if (entry.depth >= depth) {
+            if (entry.bound() == Bound::EXACT) return entry.score;
+            if (entry.bound() == Bound::LOWER && entry.score >= beta) return entry.score;
+            if (entry.bound() == Bound::UPPER && entry.score <= alpha) return entry.score;
+        }
+        hashMove = entry.move;
+    }
+
+    int bestScore;
+    PackedMove bestMove;
+    if (!searchMoves(board, depth, ply, alpha, beta, hashMove, bestMove, bestScore)) {
+        return 0;
+    }
+
     // Check for terminal nodes (checkmate or stalemate).
-    std::vector<Move> legalMoves = board.generateLegalMoves();
-    if (legalMoves.empty()) {
-        if (board.isKingInCheck(board.getSideToMove())) {
-            return (board.getSideToMove() == Color::WHITE) ? -std::numeric_limits<int>::max() : std::numeric_limits<int>::max();
+    if (bestMove == PackedMove()) {
+        return board.isKingInCheck(board.getSideToMove()) ? -INFINITE_SCORE : 0;
+    }
+    return bestScore;
+}
+
+// Searches the moves of a position in picker order, firstMove first, and
+// stores the result. Principal variation search: the first move is searched
+// with the full window, and every later one only with a null window around
+// alpha to prove it is no better. A move that fails that proof is searched
+// again with the full window. Returns false if the hard limit stopped it.
+bool MinMaxPlayer::searchMoves(Board& board, int depth, int ply, int alpha, int beta, PackedMove firstMove,
+                               PackedMove& bestMove, int& bestScore) {
+    int originalAlpha = alpha;
+    bestScore = -INFINITE_SCORE;
+    bestMove = PackedMove();
+
+    PackedMove killer1 = ply < MAX_PLY ? killers[ply][0] : PackedMove();
+    PackedMove killer2 = ply < MAX_PLY ? killers[ply][1] : PackedMove();
+    MovePicker picker(board, firstMove, killer1, killer2, &history);
+    MoveList quietsTried;
+    for (PackedMove move = picker.next(); move != PackedMove(); move = picker.next()) {
+        bool quiet = isQuiet(board, move);
+        UndoInfo undo;
+        board.doMove(move, undo);
+        int score;
+        if (bestMove == PackedMove()) {
+            score = -negamax(board, depth - 1, ply + 1, -beta, -alpha);
         } else {
-            return 0; // Stalemate
+            score = -negamax(board, depth - 1, ply + 1, -alpha - 1, -alpha);
+            if (score > alpha && score < beta) {
+                score = -negamax(board, depth - 1, ply + 1, -beta, -alpha);
+            }
         }
+        board.undoMove(undo);
+        if (stopped) return false;
+
+        if (score > bestScore || bestMove == PackedMove()) {
+            bestScore = score;
+            bestMove = move;
+        }
+        alpha = std::max(alpha, score);
+        if (alpha >= beta) {
+            if (quiet) updateQuietStats(board, move, quietsTried, depth, ply);
+            break;
+        }
+        if (quiet) quietsTried.push_back(move);
     }
 
-    std::vector<Move> captureMoves;
-    std::vector<Move> nonCaptureMoves;
-    for (const auto& move : legalMoves) {
-        if (board.isCaptureMove(move)) {
-            captureMoves.push_back(move);
-        } else {
-            nonCaptureMoves.push_back(move);
+    if (bestMove != PackedMove()) {
+        storeResult(board.hash(), depth, bestScore, originalAlpha, beta, bestMove);
+    }
+    return true;
+}
+
+// A quiet move that refutes a position is likely to refute its siblings
+// too, so it becomes a killer at this ply and gains history in proportion to
+// the depth it was searched to. The quiet moves tried before it lose as much.
+void MinMaxPlayer::updateQuietStats(Board& board, PackedMove move, const MoveList& quietsTried, int depth, int ply) {
+    if (ply < MAX_PLY && killers[ply][0] != move) {
+        killers[ply][1] = killers[ply][0];
+        killers[ply][0] = move;
+    }
+    int color = static_cast<int>(board.getSideToMove());
+    int bonus = depth * depth;
+    bool overflow = false;
+    int& score = history[color][move.from()][move.to()];
+    score += bonus;
+    overflow |= score > HISTORY_LIMIT;
+    for (PackedMove tried : quietsTried) {
+        int& triedScore = history[color][tried.from()][tried.to()];
+        triedScore -= bonus;
+        overflow |= triedScore < -HISTORY_LIMIT;
+    }
+    if (overflow) {
+        ageHistory();
+    }
+}
+
+// Halving keeps the order of the history scores while letting recent
+// cutoffs outweigh old ones.
+void MinMaxPlayer::ageHistory() {
+    for (auto& color : history) {
+        for (auto& from : color) {
+            for (int& score : from) {
+                score /= 2;
+            }
         }
     }
-    std::vector<Move> sortedMoves;
-    sortedMoves.insert(sortedMoves.end(), captureMoves.begin(), captureMoves.end());
-    sortedMoves.insert(sortedMoves.end(), nonCaptureMoves.begin(), nonCaptureMoves.end());
-
-    if (board.getSideToMove() == Color::WHITE) {
-        int maxEval = -std::numeric_limits<int>::max();
-        for (const auto& move : sortedMoves) {
-            std::shared_ptr<Board> tempBoard = std::make_shared<Board>(board);
-            // tempBoard->setVerbose(true);
-            tempBoard->makeMove(move);
-            int eval = minimax(*tempBoard, depth - 1, alpha, beta);
-            maxEval = std::max(maxEval, eval);
-            alpha = std::max(alpha, eval);
-            if (beta <= alpha) {
-                break;
+}
+
+// Plays out captures and queen promotions until the position is quiet, so
+// the static evaluation is never taken halfway through an exchange. The side
+// to move may stand pat on the evaluation instead of capturing, except in
+// check, where every evasion is searched.
+int MinMaxPlayer::quiescence(Board& board, int alpha, int beta) {
+    if (timed && (++nodes & 1023) == 0 && Clock::now() >= hardDeadline) {
+        stopped = true;
+    }
+    if (stopped) {
+        return 0;
+    }
+
+    bool inCheck = board.isKingInCheck(board.getSideToMove());
+    int standPat = -INFINITE_SCORE;
+    if (!inCheck) {
+        standPat = board.getSideToMove() == Color::WHITE ? evaluate(board) : -evaluate(board);
+        if (standPat >= beta) return standPat;
+        alpha = std::max(alpha, standPat);
+    }
+
+    MovePicker picker = inCheck ? MovePicker(board) : MovePicker(board, MovePicker::CapturesOnly{});
+    int bestScore = standPat;
+    bool anyMove = false;
+    for (PackedMove move = picker.next(); move != PackedMove(); move = picker.next()) {
+        anyMove = true;
+        // Delta pruning: skip a capture that could not bring the score back
+        // to alpha even if the captured piece came for free. Its optimistic
+        // value still counts, so a fail-low result stays a true upper bound.
+        if (!inCheck && move.kind() != PackedMove::PROMOTION) {
+            int gain = move.kind() == PackedMove::EN_PASSANT
+                ? delta_piece_values[static_cast<int>(PieceType::PAWN)]
+                : delta_piece_values[static_cast<int>(pieceTypeOf(board.pieceOn(move.to())))];
+            if (standPat + gain + DELTA_MARGIN <= alpha) {
+                bestScore = std::max(bestScore, standPat + gain + DELTA_MARGIN);
+                continue;
             }
         }
-        if (depth >= 2) {
-            // std::cout << "score of board at depth " << depth << " is " << maxEval << std::endl;
-            // std::cout << board.toString() << std::endl;
+
+        UndoInfo undo;
+        board.doMove(move, undo);
+        int score = -quiescence(board, -beta, -alpha);
+        board.undoMove(undo);
+        if (stopped) return 0;
+
+        bestScore = std::max(bestScore, score);
+        alpha = std::max(alpha, score);
+        if (alpha >= beta) {
+            break;
         }
-        return maxEval;
-    } else {
-        int minEval = std::numeric_limits<int>::max();
-        for (const auto& move : sortedMoves) {
-            std::shared_ptr<Board> tempBoard = std::make_shared<Board>(board);
-            // tempBoard->setVerbose(true);
-            tempBoard->makeMove(move);
-            int eval = minimax(*tempBoard, depth - 1, alpha, beta);
-            minEval = std::min(minEval, eval);
-            beta = std::min(beta, eval);
-            if (beta <= alpha) {
-                break;
-            }
+    }
+
+    // In check the picker offered every legal move, so having none is mate.
+    if (inCheck && !anyMove) {
+        return -INFINITE_SCORE;
+    }
+    return bestScore;
+}
+
+// Results outside the window are only bounds: at or below alpha every move
+// failed low, at or above beta the search stopped at a refutation.
+void MinMaxPlayer::storeResult(uint64_t key, int depth, int score, int alpha, int beta, PackedMove bestMove) {
+    Bound bound = score <= alpha ? Bound::UPPER : score >= beta ? Bound::LOWER : Bound::EXACT;
+    table.store(key, depth, bound, score, bestMove);
+}
+
+void MinMaxPlayer::setTimeControl(std::chrono::milliseconds remaining, std::chrono::milliseconds increment) {
+    timed = true;
+    remainingTime = remaining;
+    incrementTime = increment;
+}
+
+// Aim to spend a fortieth of the clock plus most of the increment, and never
+// let one move take more than a fifth of what is left. An iteration may run
+// on to four times the soft limit before it is aborted.
+MinMaxPlayer::TimeBudget MinMaxPlayer::timeBudget(std::chrono::milliseconds remaining, std::chrono::milliseconds increment) {
+    std::chrono::milliseconds ceiling = remaining / 5;
+    std::chrono::milliseconds soft = std::min(remaining / 40 + increment * 3 / 4, ceiling);
+    return {soft, std::min(soft * 4, ceiling)};
+}
+
+// Searches one iteration inside an aspiration window around the previous
+// iteration's score. A score outside the window is only a bound, so the
+// window is widened on that side, doubling each time, and the root searched
+// again. Returns false if the hard limit cut the iteration short, in which
+// case bestMove and bestScore are left as they were.
+bool MinMaxPlayer::searchRoot(Board& board, int depth, PackedMove& bestMove, int& bestScore) {
+    int delta = ASPIRATION_WINDOW;
+    int alpha = -INFINITE_SCORE;
+    int beta = INFINITE_SCORE;
+    // The first iterations are too shallow for their score to predict the
+    // next one, and a mate score has nothing to aim around.
+    if (depth >= 3 && std::abs(bestScore) != INFINITE_SCORE) {
+        alpha = bestScore - delta;
+        beta = bestScore + delta;
+    }
+
+    while (true) {
+        PackedMove move;
+        int score;
+        if (!searchMoves(board, depth, 0, alpha, beta, bestMove, move, score)) {
+            return false;
         }
-        if (depth >= 2) {
-            // std::cout << "score of board at depth " << depth << " is " << minEval << std::endl;
-            // std::cout << board.toString() << std::endl;
+        if (score <= alpha && alpha != -INFINITE_SCORE) {
+            // Failed low: every move is at most alpha, so none is known to be
+            // best yet and the previous best move stays first in line.
+            delta *= 2;
+            alpha = delta > MAX_ASPIRATION_WINDOW ? -INFINITE_SCORE : alpha - delta;
+        } else if (score >= beta && beta != INFINITE_SCORE) {
+            // Failed high: this move is better than expected, so it leads the
+            // re-search and is kept should the clock run out during it.
+            bestMove = move;
+            delta *= 2;
+            beta = delta > MAX_ASPIRATION_WINDOW ? INFINITE_SCORE : beta + delta;
+        } else {
+            bestMove = move;
+            bestScore = score;
+            return true;
         }
-        return minEval;
     }
 }
 
 bool MinMaxPlayer::makeMove(Board& board) {
-    std::vector<Move> legalMoves = board.generateLegalMoves();
-    if (legalMoves.empty()) {
+    Clock::time_point start = Clock::now();
+    table.newSearch();
+    MoveList moves;
+    board.generateLegalMoves(moves);
+    if (moves.empty()) {
         return false;
     }
 
-    std::vector<Move> captureMoves;
-    std::vector<Move> nonCaptureMoves;
-    for (const auto& move : legalMoves) {
-        if (board.isCaptureMove(move)) {
-            captureMoves.push_back(move);
-        } else {
-            nonCaptureMoves.push_back(move);
-        }
+    std::chrono::milliseconds softLimit{0};
+    if (timed) {
+        TimeBudget budget = timeBudget(remainingTime, incrementTime);
+        softLimit = budget.soft;
+        hardDeadline = start + budget.hard;
     }
-    std::vector<Move> sortedMoves;
-    sortedMoves.insert(sortedMoves.end(), captureMoves.begin(), captureMoves.end());
-    sortedMoves.insert(sortedMoves.end(), nonCaptureMoves.begin(), nonCaptureMoves.end());
-
-    int bestScore = (board.getSideToMove() == Color::WHITE) ? -std::numeric_limits<int>::max() : std::numeric_limits<int>::max();
-    Move bestMove = sortedMoves[0];
-
-    // std::cout << "eval of current position is: " << evaluate(board) << std::endl;
-    for (const auto& move : sortedMoves) {
-        std::shared_ptr<Board> tempBoard = std::make_shared<Board>(board);
-        tempBoard->makeMove(move);
-        int score = minimax(*tempBoard, searchDepth-1, -std::numeric_limits<int>::max(), std::numeric_limits<int>::max());
-        // std::cout << "score of move: " << toAlgebraicNotation(move.start) << " -> " << toAlgebraicNotation(move.end) << " is " << score << std::endl;
-        // std::cout << "  eval of resulting position is: " << evaluate(*tempBoard) << std::endl;
-
-        if (board.getSideToMove() == Color::WHITE) {
-            if (score > bestScore) {
-                bestScore = score;
-                bestMove = move;
+    stopped = false;
+    nodes = 0;
+    // The last search started two plies earlier, so its killers move up
+    // two plies; the history carries over at half weight.
+    std::copy(&killers[2][0], &killers[0][0] + MAX_PLY * 2, &killers[0][0]);
+    std::fill(&killers[MAX_PLY - 2][0], &killers[0][0] + MAX_PLY * 2, PackedMove());
+    ageHistory();
+
+    TTEntry entry;
+    PackedMove bestMove = table.probe(board.hash(), entry) ? entry.move : PackedMove();
+    int bestScore = 0;
+    int stableIterations = 0;
+    for (int depth = 1; depth <= searchDepth; ++depth) {
+        PackedMove previousMove = bestMove;
+        if (!searchRoot(board, depth, bestMove, bestScore)) {
+            break;
+        }
+        stableIterations = (bestMove == previousMove) ? stableIterations + 1 : 0;
+
+        // A forced mate will not change with more depth.
+        if (std::abs(bestScore) == INFINITE_SCORE) {
+            break;
+        }
+        if (timed) {
+            Clock::duration elapsed = Clock::now() - start;
+            if (elapsed >= softLimit) {
+                break;
             }
-        } else {
-            if (score < bestScore) {
-                bestScore = score;
-                bestMove = move;
+            // A move that has survived several deeper looks is unlikely to
+            // change, so half the budget is enough.
+            if (stableIterations >= 3 && elapsed >= softLimit / 2) {
+                break;
             }
         }
     }
+    // Even depth 1 can overrun a nearly empty clock; any legal move beats losing on time.
+    if (bestMove == PackedMove() || !board.isLegal(bestMove)) {
+        bestMove = moves[0];
+    }
+
+    if (timed) {
+        remainingTime += incrementTime - std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start);
+        remainingTime = std::max(remainingTime, std::chrono::milliseconds(0));
+    }
 
     std::string colorToMove = (board.getSideToMove() == Color::WHITE) ? "White" : "Black";
-    std::cout << colorToMove << " made move (" << toAlgebraicNotation(bestMove.start) << ", " << toAlgebraicNotation(bestMove.end) << ")" << std::endl;
+    std::cout << colorToMove << " made move (" << toAlgebraicNotation(bestMove.toMove().start) << ", " << toAlgebraicNotation(bestMove.toMove().end) << ")" << std::endl;
 
     return board.makeMove(bestMove);
-}
\ No newline at end of file
+}
@@ -0,0 +1,163 @@
+#include "move_picker.h"
+#include <utility>
+
+namespace {
+
+// Rough piece values indexed by PieceType, used only for ordering. The king
+// is worth nothing as an attacker, since a legal king capture is never recaptured.
+constexpr int PIECE_VALUES[6] = { 900, 500, 320, 330, 100, 0 };
+
+bool isQueenPromotion(PackedMove move) {
+    return move.kind() == PackedMove::PROMOTION && move.promotionPiece() == PieceType::QUEEN;
+}
+
+} // namespace
+
+MovePicker::MovePicker(Board& board, PackedMove hashMove, PackedMove killer1, PackedMove killer2,
+                       const ButterflyHistory* history)
+    : board(board), hashMove(hashMove), killers{killer1, killer2}, history(history) {}
+
+MovePicker::MovePicker(Board& board, CapturesOnly)
+    : board(board), stage(GENERATE_CAPTURES), capturesOnly(true) {}
+
+// Moves handed out by an earlier stage are not repeated by a later one.
+bool MovePicker::isSkipped(PackedMove move) const {
+    return move == hashMove || move == killers[0] || move == killers[1];
+}
+
+int MovePicker::captureScore(PackedMove move) const {
+    if (move.kind() == PackedMove::EN_PASSANT) {
+        return PIECE_VALUES[static_cast<int>(PieceType::PAWN)] * 8 - PIECE_VALUES[static_cast<int>(PieceType::PAWN)];
+    }
+    int victim = PIECE_VALUES[static_cast<int>(pieceTypeOf(board.pieceOn(move.to())))];
+    int attacker = PIECE_VALUES[static_cast<int>(pieceTypeOf(board.pieceOn(move.from())))];
+    int score = victim * 8 - attacker;
+    if (isQueenPromotion(move)) score += PIECE_VALUES[static_cast<int>(PieceType::QUEEN)] * 8;
+    return score;
+}
+
+// A capture is good if it does not lose material once the exchange on its
+// square is played out.
+bool MovePicker::isGoodCapture(PackedMove move) const {
+    return board.seeGE(move, 0);
+}
+
+// Insertion sort by history, highest first. Quiet moves are usually all
+// searched once the killers have failed, so they are sorted up front rather
+// than picked one at a time, and ties keep generation order.
+void MovePicker::sortQuiets() {
+    int color = static_cast<int>(board.getSideToMove());
+    for (size_t i = 0; i < moves.size(); ++i) {
+        scores[i] = (*history)[color][moves[i].from()][moves[i].to()];
+    }
+    for (size_t i = 1; i < moves.size(); ++i) {
+        PackedMove move = moves[i];
+        int score = scores[i];
+        size_t j = i;
+        for (; j > 0 && scores[j - 1] < score; --j) {
+            moves[j] = moves[j - 1];
+            scores[j] = scores[j - 1];
+        }
+        moves[j] = move;
+        scores[j] = score;
+    }
+}
+
+// Only the moves actually searched get ordered, so a cutoff early in the
+// stage saves sorting the rest.
+PackedMove MovePicker::pickBest() {
+    size_t best = current;
+    for (size_t i = current + 1; i < moves.size(); ++i) {
+        if (scores[i] > scores[best]) best = i;
+    }
+    std::swap(moves[current], moves[best]);
+    std::swap(scores[current], scores[best]);
+    return moves[current++];
+}
+
+PackedMove MovePicker::next() {
+    switch (stage) {
+        case HASH_MOVE:
+            stage = GENERATE_CAPTURES;
+            if (hashMove != PackedMove() && board.isLegal(hashMove)) return hashMove;
+            hashMove = PackedMove();
+            [[fallthrough]];
+
+        case GENERATE_CAPTURES: {
+            board.generateCaptures(moves);
+            // Queen promotions without a capture get their own stage.
+            size_t count = 0;
+            for (PackedMove move : moves) {
+                if (move == hashMove) continue;
+                if (!board.isCaptureMove(move)) {
+                    promotions.push_back(move);
+                    continue;
+                }
+                scores[count] = captureScore(move);
+                moves[count++] = move;
+            }
+            moves.resize(count);
+            current = 0;
+            stage = GOOD_CAPTURES;
+            [[fallthrough]];
+        }
+
+        case GOOD_CAPTURES:
+            while (current < moves.size()) {
+                PackedMove move = pickBest();
+                if (isGoodCapture(move)) return move;
+                badCaptures.push_back(move);
+            }
+            stage = PROMOTIONS;
+            [[fallthrough]];
+
+        case PROMOTIONS:
+            if (promotionIndex < promotions.size()) return promotions[promotionIndex++];
+            // Losing captures are not worth resolving in quiescence.
+            if (capturesOnly) {
+                stage = DONE;
+                return PackedMove();
+            }
+            stage = KILLERS;
+            [[fallthrough]];
+
+        case KILLERS:
+            while (killerIndex < 2) {
+                PackedMove& killer = killers[killerIndex++];
+                // Killers come from sibling nodes, so they must be re-checked
+                // here and are only used while they are still quiet moves.
+                bool usable = killer != PackedMove() && killer != hashMove &&
+                              (killerIndex == 1 || killer != killers[0]) &&
+                              !board.isCaptureMove(killer) && !isQueenPromotion(killer) &&
+                              board.isLegal(killer);
+                if (usable) return killer;
+                killer = PackedMove();
+            }
+            stage = GENERATE_QUIETS;
+            [[fallthrough]];
+
+        case GENERATE_QUIETS:
+            board.generateLegalMoves(moves, MoveGenType::QUIETS);
+            if (history) sortQuiets();
+            current = 0;
+            stage = QUIETS;
+            [[fallthrough]];
+
+        case QUIETS:
+            while (current < moves.size()) {
+                PackedMove move = moves[current++];
+                if (!isSkipped(move)) return move;
+            }
+            stage = BAD_CAPTURES;
+            [[fallthrough]];
+
+        case BAD_CAPTURES:
+            if (badCaptureIndex < badCaptures.size()) return badCaptures[badCaptureIndex++];
+            stage = DONE;
+            [[fallthrough]];
+
+        case DONE:
+            return PackedMove();
+    }
+    return PackedMove();
+}
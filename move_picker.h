@@ -0,0 +1,70 @@
+#ifndef MOVE_PICKER_H
+#define MOVE_PICKER_H
+
+#include "board.h"
+
+// Butterfly history: a score per [color][from][to] that rises when that
+// quiet move causes a beta cutoff and falls when it was tried before one.
+using ButterflyHistory = int[2][64][64];
+
+// Hands out the legal moves of a position one at a time in search order:
+// hash move, good captures, queen promotions, killers, quiet moves (best
+// history first, given a table) and finally bad captures. Each stage is
+// only generated once the previous one is exhausted, so a cutoff on an
+// early move skips the rest of the work.
+class MovePicker {
+public:
+    MovePicker(Board& board, PackedMove hashMove = PackedMove(),
+               PackedMove killer1 = PackedMove(), PackedMove killer2 = PackedMove(),
+               const ButterflyHistory* history = nullptr);
+
+    // Selects the quiescence picker, which stops after the good captures and
+    // queen promotions.
+    struct CapturesOnly {};
+    MovePicker(Board& board, CapturesOnly);
+
+    // Returns the next move, or PackedMove() once every stage is exhausted.
+    PackedMove next();
+
+private:
+    enum Stage {
+        HASH_MOVE,
+        GENERATE_CAPTURES,
+        GOOD_CAPTURES,
+        PROMOTIONS,
+        KILLERS,
+        GENERATE_QUIETS,
+        QUIETS,
+        BAD_CAPTURES,
+        DONE
+    };
+
+    Board& board;
+    Stage stage = HASH_MOVE;
+    bool capturesOnly = false;
+    PackedMove hashMove;
+    PackedMove killers[2];
+    const ButterflyHistory* history = nullptr;
+
+    // Moves of the current stage, with MVV-LVA scores for the captures and
+    // history scores for the quiet moves.
+    MoveList moves;
+    int scores[MoveList::CAPACITY];
+    size_t current = 0;
+
+    MoveList promotions;
+    MoveList badCaptures;
+    size_t promotionIndex = 0;
+    size_t killerIndex = 0;
+    size_t badCaptureIndex = 0;
+
+    bool isSkipped(PackedMove move) const;
+    bool isGoodCapture(PackedMove move) const;
+    int captureScore(PackedMove move) const;
+    // Selection sort step: moves the best scored of the remaining moves of
+    // the stage to current and returns it.
+    PackedMove pickBest();
+    void sortQuiets();
+};
+
+#endif // MOVE_PICKER_H
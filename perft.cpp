@@ -0,0 +1,136 @@
+#include "perft.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <thread>
+
+const PerftPosition STANDARD_PERFT_POSITIONS[6] = {
+    { "start", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 5, 4865609 },
+    { "kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4, 4085603 },
+    { "position 3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 6, 11030083 },
+    { "position 4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 5, 15833292 },
+    { "position 5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4, 2103487 },
+    { "position 6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4, 3894594 },
+};
+
+PerftTable::PerftTable(size_t megabytes) {
+    // Round down to a power of two number of entries, keeping at least one.
+    size_t count = std::max<size_t>(1, megabytes * 1024 * 1024 / sizeof(Entry));
+    count = std::bit_floor(count);
+    entries = std::make_unique<Entry[]>(count);
+    mask = count - 1;
+    clear();
+}
+
+bool PerftTable::probe(uint64_t key, int depth, uint64_t& nodes) const {
+    const Entry& entry = entries[key & mask];
+    uint64_t data = entry.data.load(std::memory_order_relaxed);
+    uint64_t check = entry.key.load(std::memory_order_relaxed) ^ data;
+    if (check != key || (data & 0xFF) != static_cast<uint64_t>(depth)) return false;
+    nodes = data >> 8;
+    return true;
+}
+
+void PerftTable::store(uint64_t key, int depth, uint64_t nodes) {
+    Entry& entry = entries[key & mask];
+    uint64_t data = (nodes << 8) | static_cast<uint64_t>(depth);
+    entry.key.store(key ^ data, std::memory_order_relaxed);
+    entry.data.store(data, std::memory_order_relaxed);
+}
+
+void PerftTable::clear() {
+    for (size_t i = 0; i <= mask; ++i) {
+        entries[i].key.store(0, std::memory_order_relaxed);
+        entries[i].data.store(0, std::memory_order_relaxed);
+    }
+}
+
+uint64_t perft(Board& board, int depth, PerftTable* table) {
+    if (depth == 0) return 1;
+
+    uint64_t nodes;
+    if (depth > 1 && table && table->probe(board.hash(), depth, nodes)) return nodes;
+
+    MoveList moves;
+    board.generateLegalMoves(moves);
+    if (depth == 1) return moves.size();
+
+    nodes = 0;
+    for (PackedMove move : moves) {
+        UndoInfo undo;
+        board.doMove(move, undo);
+        nodes += perft(board, depth - 1, table);
+        board.undoMove(undo);
+    }
+
+    if (table) table->store(board.hash(), depth, nodes);
+    return nodes;
+}
+
+std::vector<PerftDivideEntry> perftDivide(Board& board, int depth, PerftTable* table) {
+    std::vector<PerftDivideEntry> result;
+    if (depth < 1) return result;
+
+    MoveList moves;
+    board.generateLegalMoves(moves);
+    for (PackedMove move : moves) {
+        UndoInfo undo;
+        board.doMove(move, undo);
+        result.push_back({move, perft(board, depth - 1, table)});
+        board.undoMove(undo);
+    }
+    return result;
+}
+
+std::vector<PerftDivideEntry> perftDivideParallel(Board& board, int depth, int threads, PerftTable* table) {
+    if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    // Below depth 3 there is too little work per subtree to be worth a thread.
+    if (depth < 3 || threads == 1) return perftDivide(board, depth, table);
+
+    // One task per (root move, reply) pair, in generation order.
+    struct Task {
+        int root;
+        PackedMove reply;
+        uint64_t nodes;
+    };
+    MoveList rootMoves;
+    board.generateLegalMoves(rootMoves);
+    std::vector<Task> tasks;
+    for (size_t i = 0; i < rootMoves.size(); ++i) {
+        UndoInfo undo;
+        board.doMove(rootMoves[i], undo);
+        MoveList replies;
+        board.generateLegalMoves(replies);
+        for (PackedMove reply : replies) tasks.push_back({static_cast<int>(i), reply, 0});
+        board.undoMove(undo);
+    }
+
+    std::atomic<size_t> nextTask{0};
+    auto worker = [&]() {
+        Board local(board);
+        for (size_t i = nextTask.fetch_add(1); i < tasks.size(); i = nextTask.fetch_add(1)) {
+            Task& task = tasks[i];
+            UndoInfo rootUndo, replyUndo;
+            local.doMove(rootMoves[task.root], rootUndo);
+            local.doMove(task.reply, replyUndo);
+            task.nodes = perft(local, depth - 2, table);
+            local.undoMove(replyUndo);
+            local.undoMove(rootUndo);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int i = 0; i < threads; ++i) pool.emplace_back(worker);
+    for (auto& thread : pool) thread.join();
+
+    std::vector<PerftDivideEntry> result;
+    for (PackedMove move : rootMoves) result.push_back({move, 0});
+    for (const Task& task : tasks) result[task.root].nodes += task.nodes;
+    return result;
+}
+
+uint64_t perftParallel(Board& board, int depth, int threads, PerftTable* table) {
+    if (depth < 1) return perft(board, depth, table);
+    uint64_t nodes = 0;
+    for (const auto& entry : perftDivideParallel(board, depth, threads, table)) nodes += entry.nodes;
+    return nodes;
+}
@@ -0,0 +1,65 @@
+#ifndef PERFT_H
+#define PERFT_H
+
+#include "board.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Caches perft subtree counts by position key and depth. Always-replace,
+// sized to a power of two so the key can be masked into an index. Safe to
+// share between threads: each entry stores key ^ data, so a torn write by a
+// racing thread fails the key check instead of returning a wrong count.
+class PerftTable {
+public:
+    explicit PerftTable(size_t megabytes);
+
+    bool probe(uint64_t key, int depth, uint64_t& nodes) const;
+    void store(uint64_t key, int depth, uint64_t nodes);
+    void clear();
+
+private:
+    // The low byte of data holds the depth, the rest the node count.
+    struct Entry {
+        std::atomic<uint64_t> key;
+        std::atomic<uint64_t> data;
+    };
+
+    std::unique_ptr<Entry[]> entries;
+    size_t mask;
+};
+
+// Counts the leaf nodes of the legal move tree to the given depth. The last
+// ply is bulk counted: the moves are generated but never made.
+uint64_t perft(Board& board, int depth, PerftTable* table = nullptr);
+
+struct PerftDivideEntry {
+    PackedMove move;
+    uint64_t nodes;
+};
+
+// Per-root-move breakdown of perft, in generation order.
+std::vector<PerftDivideEntry> perftDivide(Board& board, int depth, PerftTable* table = nullptr);
+
+// Parallel versions of the above. The tree is split into the subtrees two
+// plies below the root, which worker threads take from a shared queue as
+// they finish their previous one, each on its own copy of the board. The
+// counts are identical to the single-threaded ones. A table passed in is
+// shared by all threads. threads <= 0 uses the hardware concurrency.
+uint64_t perftParallel(Board& board, int depth, int threads, PerftTable* table = nullptr);
+std::vector<PerftDivideEntry> perftDivideParallel(Board& board, int depth, int threads, PerftTable* table = nullptr);
+
+// A well-known perft position with its reference node count.
+struct PerftPosition {
+    const char* name;
+    const char* fen;
+    int depth;
+    uint64_t nodes;
+};
+
+// The standard positions from the Chess Programming Wiki.
+extern const PerftPosition STANDARD_PERFT_POSITIONS[6];
+
+#endif // PERFT_H
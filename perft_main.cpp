@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include "board.h"
+#include "perft.h"
+
+// Usage:
+//   perft                          run the standard positions and check their counts
+//   perft --fen "<fen>" --depth N  count one position
+// Options:
+//   --divide     print the node count below each root move
+//   --hash MB    cache subtree counts in a table of the given size
+//   --threads N  split the tree across N threads; 0 uses every core
+static void printUsage() {
+    std::cerr << "usage: perft [--fen <fen>] [--depth N] [--divide] [--hash MB] [--threads N]" << std::endl;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Runs one perft and prints its node count, time and nodes per second.
+static uint64_t runPerft(Board& board, int depth, bool divide, int threads, PerftTable* table) {
+    auto start = std::chrono::steady_clock::now();
+    uint64_t nodes = 0;
+    if (divide) {
+        for (const auto& entry : perftDivideParallel(board, depth, threads, table)) {
+            std::cout << toUCINotation(entry.move) << ": " << entry.nodes << std::endl;
+            nodes += entry.nodes;
+        }
+    } else {
+        nodes = perftParallel(board, depth, threads, table);
+    }
+    double seconds = secondsSince(start);
+    std::cout << "nodes " << nodes << "  time " << seconds << "s  nps "
+              << static_cast<uint64_t>(nodes / std::max(seconds, 1e-9)) << std::endl;
+    return nodes;
+}
+
+int main(int argc, char* argv[]) {
+    std::string fen;
+    int depth = 0;
+    bool divide = false;
+    size_t hashMegabytes = 0;
+    int threads = 1;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--divide") {
+            divide = true;
+        } else if (arg == "--fen" && i + 1 < argc) {
+            fen = argv[++i];
+        } else if (arg == "--depth" && i + 1 < argc) {
+            depth = std::atoi(argv[++i]);
+        } else if (arg == "--hash" && i + 1 < argc) {
+            hashMegabytes = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::atoi(argv[++i]);
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    std::unique_ptr<PerftTable> table;
+    if (hashMegabytes) table = std::make_unique<PerftTable>(hashMegabytes);
+
+    if (!fen.empty()) {
+        auto board = Board::fromFEN(fen);
+        if (!board || depth < 1) {
+            printUsage();
+            return 1;
+        }
+        runPerft(*board, depth, divide, threads, table.get());
+        return 0;
+    }
+
+    // No position given: run the standard suite, optionally at a fixed depth.
+    bool allPassed = true;
+    uint64_t totalNodes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& position : STANDARD_PERFT_POSITIONS) {
+        auto board = Board::fromFEN(position.fen);
+        int searchDepth = depth ? depth : position.depth;
+        std::cout << position.name << " depth " << searchDepth << std::endl;
+        if (table) table->clear();
+        uint64_t nodes = runPerft(*board, searchDepth, divide, threads, table.get());
+        totalNodes += nodes;
+        if (searchDepth == position.depth && nodes != position.nodes) {
+            std::cout << "MISMATCH: expected " << position.nodes << std::endl;
+            allPassed = false;
+        }
+    }
+    double seconds = secondsSince(start);
+    std::cout << "total nodes " << totalNodes << "  time " << seconds << "s  nps "
+              << static_cast<uint64_t>(totalNodes / std::max(seconds, 1e-9)) << std::endl;
+    return allPassed ? 0 : 1;
+}
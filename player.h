@@ -1,4 +1,7 @@
 #include "board.h"
+#include "transposition_table.h"
+#include "move_picker.h"
+#include <chrono>
 
 // Player interface (abstract class)
 class Player {
@@ -22,10 +25,43 @@ public:
 // MinMaxPlayer class that implements the Player interface
 class MinMaxPlayer : public Player {
 public:
-    MinMaxPlayer(int depth);
+    // hashMegabytes sizes the transposition table shared by all its searches.
+    MinMaxPlayer(int depth, size_t hashMegabytes = 16);
     bool makeMove(Board& board) override;
+    // Puts the player on a clock: each move deepens until its share of the
+    // remaining time is spent, with depth only as a ceiling. The player keeps
+    // its own clock from here on; calling this again resynchronises it.
+    void setTimeControl(std::chrono::milliseconds remaining, std::chrono::milliseconds increment);
+
+    // Time one move may take: the soft limit decides whether another
+    // iteration starts, the hard limit aborts one already running.
+    struct TimeBudget {
+        std::chrono::milliseconds soft;
+        std::chrono::milliseconds hard;
+    };
+    static TimeBudget timeBudget(std::chrono::milliseconds remaining, std::chrono::milliseconds increment);
 private:
+    using Clock = std::chrono::steady_clock;
+    static constexpr int MAX_PLY = 128;
     int searchDepth;
+    TranspositionTable table;
+    // Quiet moves that caused a beta cutoff, two per distance from the root,
+    // and the history of all such cutoffs for ordering the rest.
+    PackedMove killers[MAX_PLY][2] = {};
+    ButterflyHistory history = {};
+    bool timed = false;
+    std::chrono::milliseconds remainingTime{0};
+    std::chrono::milliseconds incrementTime{0};
+    Clock::time_point hardDeadline;
+    bool stopped = false;
+    uint64_t nodes = 0;
+    bool searchRoot(Board& board, int depth, PackedMove& bestMove, int& bestScore);
     int evaluate(Board& board);
-    int minimax(Board& board, int depth, int alpha, int beta);
+    int negamax(Board& board, int depth, int ply, int alpha, int beta);
+    bool searchMoves(Board& board, int depth, int ply, int alpha, int beta, PackedMove firstMove,
+                     PackedMove& bestMove, int& bestScore);
+    void updateQuietStats(Board& board, PackedMove move, const MoveList& quietsTried, int depth, int ply);
+    void ageHistory();
+    int quiescence(Board& board, int alpha, int beta);
+    void storeResult(uint64_t key, int depth, int score, int alpha, int beta, PackedMove bestMove);
 };
\ No newline at end of file
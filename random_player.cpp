@@ -1,6 +1,7 @@
 #include "player.h"
 #include "board.h"
 #include <random>
+#include <chrono>
 #include <iostream>
 
 bool RandomPlayer::makeMove(Board& board) {
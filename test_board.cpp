@@ -1,6 +1,11 @@
 #define CATCH_CONFIG_MAIN
 #include "catch2/catch_test_macros.hpp"
 #include "board.h"
+#include "epd.h"
+#include "attacks.h"
+#include <algorithm>
+#include <bit>
+#include <sstream>
 #include <iostream>
 #include <memory>
 
@@ -238,6 +243,16 @@ TEST_CASE("Board::move", "[move]") {
         REQUIRE_FALSE(customBoard->makeMove({Square::E8, Square::C8}));
     }
 
+    SECTION("Black castling queenside is not allowed if a piece stands on B8") {
+        auto customBoard = BoardBuilder(Square::E8, Square::E1, Color::BLACK)
+            .setBlackRooks(static_cast<uint64_t>(Square::A8))
+            .setBlackKnights(static_cast<uint64_t>(Square::B8))
+            .setBlackCastleQueenside(true)
+            .Build();
+
+        REQUIRE_FALSE(customBoard->makeMove({Square::E8, Square::C8}));
+    }
+
     SECTION("Black castling queenside is not allowed if king goes through check with rook") {
         auto customBoard = BoardBuilder(Square::E8, Square::E1, Color::BLACK)
             .setBlackRooks(static_cast<uint64_t>(Square::A8))
@@ -394,6 +409,20 @@ TEST_CASE("Board::generateLegalMoves", "[generateLegalMoves]") {
         REQUIRE(board->generateLegalMoves().size() == 20);
     }
 
+    SECTION("MoveList overload matches the vector overload") {
+        std::unique_ptr<Board> board = StandardBoard();
+        MoveList moves;
+        moves.push_back(PackedMove(0, 8));
+        board->generateLegalMoves(moves);
+
+        std::vector<Move> expected = board->generateLegalMoves();
+        REQUIRE(moves.size() == expected.size());
+        for (size_t i = 0; i < moves.size(); ++i) {
+            REQUIRE(moves[i].toMove().start == expected[i].start);
+            REQUIRE(moves[i].toMove().end == expected[i].end);
+        }
+    }
+
     SECTION("Pawn promotion and capture has 4 legal moves") {
         auto board = BoardBuilder(
             ".rr....."
@@ -438,4 +467,831 @@ TEST_CASE("Board::generateLegalMoves", "[generateLegalMoves]") {
         // includes the 3 king moves.
         REQUIRE(board->generateLegalMoves().size() == 11);
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Magic bitboard attacks", "[attacks]") {
+    SECTION("Magic lookups match ray walking for varied occupancies") {
+        uint64_t occupied = 0x123456789ABCDEF0ULL;
+        for (int i = 0; i < 32; ++i) {
+            // Cheap LCG to vary occupancy between iterations.
+            occupied = occupied * 6364136223846793005ULL + 1442695040888963407ULL;
+            uint64_t sparse = occupied & (occupied >> 7);
+            for (int square = 0; square < 64; ++square) {
+                REQUIRE(rookAttacks(square, sparse) == slidingAttacksSlow(square, sparse, true));
+                REQUIRE(bishopAttacks(square, sparse) == slidingAttacksSlow(square, sparse, false));
+            }
+        }
+    }
+
+    SECTION("Rook on an empty board attacks its rank and file") {
+        REQUIRE(rookAttacks(0, 0) == ((0x0101010101010101ULL | 0xFFULL) & ~1ULL));
+    }
+
+    SECTION("Slider backends agree with the per-square lookups") {
+        SliderBackend startup = sliderBackend();
+        uint64_t occupied = 0x0FEDCBA987654321ULL;
+        for (int i = 0; i < 32; ++i) {
+            occupied = occupied * 6364136223846793005ULL + 1442695040888963407ULL;
+            uint64_t sliders = occupied & (occupied >> 13) & (occupied >> 29);
+            uint64_t rooks = 0, bishops = 0;
+            for (uint64_t bb = sliders; bb; bb &= bb - 1) {
+                rooks |= rookAttacks(std::countr_zero(bb), occupied);
+                bishops |= bishopAttacks(std::countr_zero(bb), occupied);
+            }
+            REQUIRE(slidingAttacksMagic(sliders, occupied, true) == rooks);
+            REQUIRE(slidingAttacksMagic(sliders, occupied, false) == bishops);
+            if (cpuHasFastPext()) {
+                REQUIRE(slidingAttacksPext(sliders, occupied, true) == rooks);
+                REQUIRE(slidingAttacksPext(sliders, occupied, false) == bishops);
+            }
+        }
+        REQUIRE(setSliderBackend(SliderBackend::MAGIC));
+        REQUIRE(setSliderBackend(SliderBackend::PEXT) == cpuHasFastPext());
+        REQUIRE(setSliderBackend(startup));
+    }
+
+    SECTION("Per-square lookups follow the selected backend") {
+        SliderBackend startup = sliderBackend();
+        for (SliderBackend backend : {SliderBackend::MAGIC, SliderBackend::PEXT}) {
+            if (!setSliderBackend(backend)) continue;
+            REQUIRE(pextLookups == (backend == SliderBackend::PEXT));
+            uint64_t occupied = 0x3C6EF372FE94F82BULL;
+            for (int i = 0; i < 16; ++i) {
+                occupied = occupied * 6364136223846793005ULL + 1442695040888963407ULL;
+                for (int square = 0; square < 64; ++square) {
+                    REQUIRE(rookAttacks(square, occupied) == slidingAttacksSlow(square, occupied, true));
+                    REQUIRE(bishopAttacks(square, occupied) == slidingAttacksSlow(square, occupied, false));
+                }
+            }
+        }
+        REQUIRE(setSliderBackend(startup));
+    }
+
+    SECTION("Kogge-Stone fills match the lookups for whole piece sets") {
+        uint64_t occupied = 0x2545F4914F6CDD1DULL;
+        for (int i = 0; i < 64; ++i) {
+            occupied = occupied * 6364136223846793005ULL + 1442695040888963407ULL;
+            uint64_t rookLike = occupied & (occupied >> 17) & (occupied >> 31);
+            uint64_t bishopLike = occupied & (occupied >> 11) & (occupied >> 43);
+            uint64_t expected = sliderMapLookup(rookLike, bishopLike, occupied);
+            REQUIRE(sliderFillScalar(rookLike, bishopLike, occupied) == expected);
+            if (cpuHasAVX2()) REQUIRE(sliderFillAVX2(rookLike, bishopLike, occupied) == expected);
+            REQUIRE(sliderAttackMap(rookLike, bishopLike, occupied) == expected);
+        }
+        // Corners and edges are where a shift could wrap onto the next rank.
+        REQUIRE(sliderFillScalar(1ULL << 7, 1ULL << 56, 0) ==
+                (slidingAttacksSlow(7, 0, true) | slidingAttacksSlow(56, 0, false)));
+    }
+}
+
+TEST_CASE("Leaper attack tables", "[attacks]") {
+    SECTION("Knight in the corner attacks two squares") {
+        REQUIRE(KNIGHT_ATTACKS[0] == (static_cast<uint64_t>(Square::B3) | static_cast<uint64_t>(Square::C2)));
+    }
+
+    SECTION("King in the center attacks eight squares") {
+        REQUIRE(std::popcount(KING_ATTACKS[27]) == 8);
+    }
+
+    SECTION("Pawn attacks do not wrap around the board edge") {
+        REQUIRE(PAWN_ATTACKS[0][8] == static_cast<uint64_t>(Square::B3));
+        REQUIRE(PAWN_ATTACKS[1][55] == static_cast<uint64_t>(Square::G6));
+    }
+}
+
+TEST_CASE("Board::doMove and Board::undoMove", "[undoMove]") {
+    SECTION("Undoing every legal move restores the position") {
+        auto board = BoardBuilder(
+            "r...k..r"
+            ".P....p."
+            "........"
+            "...pP..."
+            "........"
+            "........"
+            "......p."
+            "R...K..R", Color::WHITE)
+            .setWhiteCastleKingside(true)
+            .setWhiteCastleQueenside(true)
+            .setBlackCastleKingside(true)
+            .setBlackCastleQueenside(true)
+            .setEnPassent(static_cast<uint64_t>(Square::D6))
+            .Build();
+        std::string before = board->toString();
+
+        std::vector<Move> moves = board->generateLegalMoves();
+        REQUIRE(!moves.empty());
+        for (const Move& move : moves) {
+            UndoInfo undo;
+            REQUIRE(board->doMove(move, undo));
+            REQUIRE(board->getSideToMove() == Color::BLACK);
+            board->undoMove(undo);
+            REQUIRE(board->toString() == before);
+            REQUIRE(board->getSideToMove() == Color::WHITE);
+            REQUIRE(board->getEnPassent() == static_cast<uint64_t>(Square::D6));
+            REQUIRE(board->getWhiteCastleKingside());
+            REQUIRE(board->getWhiteCastleQueenside());
+        }
+    }
+
+    SECTION("Moving the king loses both castling rights until undone") {
+        auto board = StandardBoard();
+        REQUIRE(board->makeMove({Square::E2, Square::E4}));
+        REQUIRE(board->makeMove({Square::E7, Square::E5}));
+
+        UndoInfo undo;
+        REQUIRE(board->doMove({Square::E1, Square::E2}, undo));
+        REQUIRE_FALSE(board->getWhiteCastleKingside());
+        REQUIRE_FALSE(board->getWhiteCastleQueenside());
+        REQUIRE(board->getBlackCastleKingside());
+
+        board->undoMove(undo);
+        REQUIRE(board->getWhiteCastleKingside());
+        REQUIRE(board->getWhiteCastleQueenside());
+        REQUIRE(board->getWhiteKing() == static_cast<uint64_t>(Square::E1));
+    }
+}
+
+TEST_CASE("Board::hash", "[hash]") {
+    SECTION("Transpositions reach the same key") {
+        auto first = StandardBoard();
+        REQUIRE(first->makeMove({Square::G1, Square::F3}));
+        REQUIRE(first->makeMove({Square::G8, Square::F6}));
+        REQUIRE(first->makeMove({Square::B1, Square::C3}));
+
+        auto second = StandardBoard();
+        REQUIRE(second->makeMove({Square::B1, Square::C3}));
+        REQUIRE(second->makeMove({Square::G8, Square::F6}));
+        REQUIRE(second->makeMove({Square::G1, Square::F3}));
+
+        REQUIRE(first->hash() == second->hash());
+        REQUIRE(first->hash() == first->computeHash());
+    }
+
+    SECTION("Side to move, castling rights and en passant change the key") {
+        auto board = StandardBoard();
+        uint64_t start = board->hash();
+        REQUIRE(board->makeMove({Square::G1, Square::F3}));
+        REQUIRE(board->makeMove({Square::G8, Square::F6}));
+        REQUIRE(board->makeMove({Square::F3, Square::G1}));
+        REQUIRE(board->makeMove({Square::F6, Square::G8}));
+        REQUIRE(board->hash() == start);
+
+        REQUIRE(board->makeMove({Square::E2, Square::E4}));
+        REQUIRE(board->hash() != start);
+        REQUIRE(board->hash() == board->computeHash());
+    }
+
+    SECTION("Undo restores the key for castling, promotion and en passant") {
+        auto board = BoardBuilder(
+            "r...k..r"
+            ".P......"
+            "........"
+            "...pP..."
+            "........"
+            "........"
+            "........"
+            "R...K..R", Color::WHITE)
+            .setWhiteCastleKingside(true)
+            .setWhiteCastleQueenside(true)
+            .setEnPassent(static_cast<uint64_t>(Square::D6))
+            .Build();
+        uint64_t before = board->hash();
+
+        for (const Move& move : board->generateLegalMoves()) {
+            UndoInfo undo;
+            REQUIRE(board->doMove(move, undo));
+            REQUIRE(board->hash() == board->computeHash());
+            board->undoMove(undo);
+            REQUIRE(board->hash() == before);
+        }
+    }
+}
+
+TEST_CASE("Board setters keep the hash current", "[hash]") {
+    auto board = StandardBoard();
+    board->setWhiteKnights(static_cast<uint64_t>(Square::C3) | static_cast<uint64_t>(Square::G1));
+    board->setBlackPawns(board->getBlackPawns() & ~static_cast<uint64_t>(Square::E7));
+    board->setWhiteCastleQueenside(false);
+    board->setBlackCastleKingside(false);
+    board->setSideToMove(Color::BLACK);
+    board->setEnPassent(static_cast<uint64_t>(Square::E3));
+    REQUIRE(board->hash() == board->computeHash());
+
+    // The key stays right through the moves made from the edited position.
+    UndoInfo undo;
+    REQUIRE(board->doMove({Square::D7, Square::D5}, undo));
+    REQUIRE(board->hash() == board->computeHash());
+    board->undoMove(undo);
+    REQUIRE(board->hash() == board->computeHash());
+}
+
+TEST_CASE("PackedMove", "[packedMove]") {
+    SECTION("Fields round-trip through 16 bits") {
+        PackedMove move(52, 60, PackedMove::PROMOTION, PieceType::KNIGHT);
+        REQUIRE(sizeof(move) == 2);
+        REQUIRE(move.from() == 52);
+        REQUIRE(move.to() == 60);
+        REQUIRE(move.kind() == PackedMove::PROMOTION);
+        REQUIRE(move.promotionPiece() == PieceType::KNIGHT);
+        REQUIRE(move.toMove().start == Square::E7);
+        REQUIRE(move.toMove().end == Square::E8);
+    }
+
+    SECTION("encodeMove derives castling, en passant and promotion from the position") {
+        auto board = BoardBuilder(
+            "....k..."
+            ".P......"
+            "........"
+            "...pP..."
+            "........"
+            "........"
+            "........"
+            "....K..R", Color::WHITE)
+            .setWhiteCastleKingside(true)
+            .setEnPassent(static_cast<uint64_t>(Square::D6))
+            .Build();
+
+        REQUIRE(board->encodeMove({Square::E1, Square::G1}).kind() == PackedMove::CASTLING);
+        REQUIRE(board->encodeMove({Square::E5, Square::D6}).kind() == PackedMove::EN_PASSANT);
+        REQUIRE(board->encodeMove({Square::B7, Square::B8, PieceType::ROOK}).kind() == PackedMove::PROMOTION);
+        REQUIRE(board->encodeMove({Square::E1, Square::F1}).kind() == PackedMove::NORMAL);
+        REQUIRE(board->isCaptureMove(Move{Square::E5, Square::D6}));
+    }
+}
+
+// Walks the move tree, requiring the pin-aware and legacy generators to agree
+// on the set of legal moves at every node.
+static void requireGeneratorsAgree(Board& board, int depth) {
+    MoveList moves;
+    board.generateLegalMoves(moves);
+
+    MoveList legacy;
+    board.setLegacyMoveGeneration(true);
+    board.generateLegalMoves(legacy);
+    board.setLegacyMoveGeneration(false);
+
+    std::vector<uint16_t> fast, slow;
+    for (const auto& move : moves) fast.push_back(move.raw());
+    for (const auto& move : legacy) slow.push_back(move.raw());
+    std::sort(fast.begin(), fast.end());
+    std::sort(slow.begin(), slow.end());
+    REQUIRE(fast == slow);
+
+    // Captures and quiet moves must split the legal moves exactly.
+    MoveList captures, quiets;
+    board.generateLegalMoves(captures, MoveGenType::CAPTURES);
+    board.generateLegalMoves(quiets, MoveGenType::QUIETS);
+    std::vector<uint16_t> split;
+    for (const auto& move : captures) {
+        bool queenPromotion = move.kind() == PackedMove::PROMOTION && move.promotionPiece() == PieceType::QUEEN;
+        REQUIRE((board.isCaptureMove(move) || queenPromotion));
+        split.push_back(move.raw());
+    }
+    for (const auto& move : quiets) {
+        REQUIRE_FALSE(board.isCaptureMove(move));
+        split.push_back(move.raw());
+    }
+    std::sort(split.begin(), split.end());
+    REQUIRE(split == fast);
+
+    // Evasions are every legal move when in check, and nothing otherwise.
+    bool inCheck = board.isKingInCheck(board.getSideToMove());
+    MoveList evasions;
+    board.generateEvasions(evasions);
+    REQUIRE(evasions.size() == (inCheck ? moves.size() : 0));
+
+    // Quiet checks are exactly the quiet moves that leave the opponent in check.
+    MoveList quietChecks;
+    board.generateQuietChecks(quietChecks);
+    std::vector<uint16_t> expectedChecks, actualChecks;
+    if (!inCheck) {
+        for (const auto& move : quiets) {
+            UndoInfo undo;
+            board.doMove(move, undo);
+            if (board.isKingInCheck(board.getSideToMove())) expectedChecks.push_back(move.raw());
+            board.undoMove(undo);
+        }
+    }
+    for (const auto& move : quietChecks) actualChecks.push_back(move.raw());
+    std::sort(expectedChecks.begin(), expectedChecks.end());
+    std::sort(actualChecks.begin(), actualChecks.end());
+    REQUIRE(actualChecks == expectedChecks);
+
+    if (depth <= 1) return;
+    for (const auto& move : moves) {
+        UndoInfo undo;
+        board.doMove(move, undo);
+        requireGeneratorsAgree(board, depth - 1);
+        board.undoMove(undo);
+    }
+}
+
+TEST_CASE("Pin-aware legal move generation", "[generateLegalMoves]") {
+    SECTION("Matches the legacy generator from the standard position") {
+        auto board = StandardBoard();
+        requireGeneratorsAgree(*board, 3);
+    }
+
+    SECTION("Matches the legacy generator on a position rich in pins and castling") {
+        auto board = BoardBuilder(
+            "r...k..r"
+            "p.ppqpb."
+            "bn..pnp."
+            "...PN..."
+            ".p..P..."
+            "..N..Q.p"
+            "PPPBBPPP"
+            "R...K..R", Color::WHITE)
+            .setWhiteCastleKingside(true)
+            .setWhiteCastleQueenside(true)
+            .setBlackCastleKingside(true)
+            .setBlackCastleQueenside(true)
+            .Build();
+        requireGeneratorsAgree(*board, 3);
+    }
+
+    SECTION("Matches the legacy generator with checks and en passant on the king's rank") {
+        auto board = BoardBuilder(
+            "........"
+            "..p....."
+            "...p...."
+            "KP.....r"
+            ".R...p.k"
+            "........"
+            "....P.P."
+            "........", Color::WHITE).Build();
+        requireGeneratorsAgree(*board, 4);
+    }
+
+    SECTION("Matches the legacy generator with capturing promotions") {
+        // Perft position 5, where d7 can promote by pushing or by taking on c8.
+        auto board = Board::fromFEN("rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8");
+        requireGeneratorsAgree(*board, 3);
+    }
+
+    SECTION("Matches the legacy generator when a capturing underpromotion checks") {
+        // d7xc8=R gives check along the back rank.
+        auto board = Board::fromFEN("rnb2k1r/pp1Pbppp/1qp5/8/2B5/P7/1PP1NnPP/RNBQK2R w KQ - 1 9");
+        requireGeneratorsAgree(*board, 3);
+    }
+
+    SECTION("En passant that exposes the king along the rank is not generated") {
+        auto board = BoardBuilder(
+            "........"
+            "........"
+            "........"
+            "KPp....r"
+            "........"
+            "........"
+            "........"
+            ".......k", Color::WHITE)
+            .setEnPassent(static_cast<uint64_t>(Square::C6))
+            .Build();
+        auto moves = board->generateLegalMoves();
+        for (const auto& move : moves) {
+            REQUIRE_FALSE((move.start == Square::B5 && move.end == Square::C6));
+        }
+    }
+
+    SECTION("Only the king moves in double check") {
+        auto board = BoardBuilder(
+            "....k..."
+            "........"
+            "........"
+            "........"
+            "........"
+            ".....n.."
+            "...Q...."
+            "r...K...", Color::WHITE).Build();
+        auto moves = board->generateLegalMoves();
+        REQUIRE_FALSE(moves.empty());
+        for (const auto& move : moves) {
+            REQUIRE(move.start == Square::E1);
+        }
+    }
+
+    SECTION("The king cannot step back along the checking ray") {
+        auto board = BoardBuilder(
+            "k...r..."
+            "........"
+            "........"
+            "........"
+            "....K..."
+            "........"
+            "........"
+            "........", Color::WHITE).Build();
+        auto moves = board->generateLegalMoves();
+        REQUIRE(moves.size() == 6);
+        for (const auto& move : moves) {
+            REQUIRE(move.end != Square::E3);
+            REQUIRE(move.end != Square::E5);
+        }
+    }
+
+    SECTION("Cached attacks follow doMove and undoMove") {
+        auto board = BoardBuilder(
+            "k...r..."
+            "........"
+            "........"
+            "........"
+            "....K..."
+            "........"
+            "........"
+            "........", Color::WHITE).Build();
+        REQUIRE(board->isKingInCheck(Color::WHITE));
+        UndoInfo undo;
+        REQUIRE(board->doMove({Square::E4, Square::D4}, undo));
+        REQUIRE_FALSE(board->isKingInCheck(Color::WHITE));
+        board->undoMove(undo);
+        REQUIRE(board->isKingInCheck(Color::WHITE));
+
+        board->setLegacyMoveGeneration(true);
+        REQUIRE(board->generateLegalMoves().size() == 6);
+    }
+}
+
+TEST_CASE("Board::generateQuietChecks", "[generateQuietChecks]") {
+    // Castling with check, a rook underpromotion check and a knight
+    // that uncovers the bishop on a3.
+    auto board = BoardBuilder(
+        ".....k.."
+        ".P......"
+        "...N...."
+        "........"
+        "........"
+        "B......."
+        "........"
+        "....K..R", Color::WHITE)
+        .setWhiteCastleKingside(true)
+        .Build();
+    requireGeneratorsAgree(*board, 3);
+
+    MoveList checks;
+    board->generateQuietChecks(checks);
+    auto contains = [&](PackedMove move) { return std::find(checks.begin(), checks.end(), move) != checks.end(); };
+    REQUIRE(contains(PackedMove(4, 6, PackedMove::CASTLING)));
+    REQUIRE(contains(PackedMove(49, 57, PackedMove::PROMOTION, PieceType::ROOK)));
+    REQUIRE_FALSE(contains(PackedMove(49, 57, PackedMove::PROMOTION, PieceType::KNIGHT)));
+    REQUIRE(contains(PackedMove(43, 26)));
+}
+
+TEST_CASE("Board::generateCaptures", "[generateCaptures]") {
+    // The pawn on d7 can promote by taking the bishop on c8 or by pushing to d8.
+    auto board = Board::fromFEN("rnb2k1r/pp1Pbppp/1qp5/8/2B5/P7/1PP1NnPP/RNBQK2R w KQ - 1 9");
+    MoveList captures, quiets, quietChecks;
+    board->generateCaptures(captures);
+    board->generateLegalMoves(quiets, MoveGenType::QUIETS);
+    board->generateQuietChecks(quietChecks);
+    auto contains = [](const MoveList& moves, PackedMove move) {
+        return std::find(moves.begin(), moves.end(), move) != moves.end();
+    };
+
+    // Every promotion that captures is a capture, whatever the new piece.
+    for (PieceType piece : {PieceType::QUEEN, PieceType::ROOK, PieceType::KNIGHT, PieceType::BISHOP}) {
+        PackedMove capture(51, 58, PackedMove::PROMOTION, piece);
+        REQUIRE(contains(captures, capture));
+        REQUIRE_FALSE(contains(quiets, capture));
+        REQUIRE_FALSE(contains(quietChecks, capture));
+    }
+    // Pushing splits as before: the queen with the captures, the rest quiet.
+    REQUIRE(contains(captures, PackedMove(51, 59, PackedMove::PROMOTION, PieceType::QUEEN)));
+    REQUIRE(contains(quiets, PackedMove(51, 59, PackedMove::PROMOTION, PieceType::ROOK)));
+    REQUIRE(contains(quietChecks, PackedMove(51, 59, PackedMove::PROMOTION, PieceType::ROOK)));
+}
+
+// Rebuilds the piece on every square from the bitboards and compares it with the mailbox.
+static void requireMailboxMatchesBitboards(Board& board) {
+    for (int square = 0; square < 64; ++square) {
+        uint64_t bit = 1ULL << square;
+        Piece expected = Piece::NO_PIECE;
+        if (board.getWhiteQueens() & bit) expected = Piece::WHITE_QUEEN;
+        else if (board.getWhiteRooks() & bit) expected = Piece::WHITE_ROOK;
+        else if (board.getWhiteKnights() & bit) expected = Piece::WHITE_KNIGHT;
+        else if (board.getWhiteBishops() & bit) expected = Piece::WHITE_BISHOP;
+        else if (board.getWhitePawns() & bit) expected = Piece::WHITE_PAWN;
+        else if (board.getWhiteKing() & bit) expected = Piece::WHITE_KING;
+        else if (board.getBlackQueens() & bit) expected = Piece::BLACK_QUEEN;
+        else if (board.getBlackRooks() & bit) expected = Piece::BLACK_ROOK;
+        else if (board.getBlackKnights() & bit) expected = Piece::BLACK_KNIGHT;
+        else if (board.getBlackBishops() & bit) expected = Piece::BLACK_BISHOP;
+        else if (board.getBlackPawns() & bit) expected = Piece::BLACK_PAWN;
+        else if (board.getBlackKing() & bit) expected = Piece::BLACK_KING;
+        REQUIRE(board.pieceOn(square) == expected);
+    }
+}
+
+TEST_CASE("Board::pieceOn", "[pieceOn]") {
+    SECTION("Standard board places the pieces on their home squares") {
+        auto board = StandardBoard();
+        REQUIRE(board->pieceOn(Square::E1) == Piece::WHITE_KING);
+        REQUIRE(board->pieceOn(Square::D8) == Piece::BLACK_QUEEN);
+        REQUIRE(board->pieceOn(Square::E4) == Piece::NO_PIECE);
+        REQUIRE(pieceTypeOf(board->pieceOn(Square::B8)) == PieceType::KNIGHT);
+        REQUIRE(pieceColorOf(board->pieceOn(Square::B8)) == Color::BLACK);
+        requireMailboxMatchesBitboards(*board);
+    }
+
+    SECTION("Setters replace the squares of a piece") {
+        auto board = StandardBoard();
+        board->setWhitePawns(static_cast<uint64_t>(Square::E4));
+        REQUIRE(board->pieceOn(Square::E2) == Piece::NO_PIECE);
+        REQUIRE(board->pieceOn(Square::E4) == Piece::WHITE_PAWN);
+        requireMailboxMatchesBitboards(*board);
+    }
+
+    SECTION("Mailbox follows castling, promotion and en passant through make and undo") {
+        auto board = BoardBuilder(
+            "r...k..r"
+            ".P......"
+            "........"
+            "...pP..."
+            "........"
+            "........"
+            "........"
+            "R...K..R", Color::WHITE)
+            .setWhiteCastleKingside(true)
+            .setWhiteCastleQueenside(true)
+            .setBlackCastleKingside(true)
+            .setBlackCastleQueenside(true)
+            .setEnPassent(static_cast<uint64_t>(Square::D6))
+            .Build();
+
+        MoveList moves;
+        board->generateLegalMoves(moves);
+        for (const auto& move : moves) {
+            UndoInfo undo;
+            REQUIRE(board->doMove(move, undo));
+            requireMailboxMatchesBitboards(*board);
+            board->undoMove(undo);
+            requireMailboxMatchesBitboards(*board);
+        }
+    }
+}
+
+TEST_CASE("Board::fromFEN and Board::toFEN", "[fen]") {
+    const std::string START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+    SECTION("The start position matches StandardBoard") {
+        auto board = Board::fromFEN(START_FEN);
+        REQUIRE(board != nullptr);
+        auto standard = StandardBoard();
+        REQUIRE(board->toString() == standard->toString());
+        REQUIRE(board->hash() == standard->hash());
+        REQUIRE(board->getWhiteCastleQueenside());
+        REQUIRE(board->getBlackCastleKingside());
+        REQUIRE(standard->toFEN() == START_FEN);
+    }
+
+    SECTION("Round trips castling rights, en passant and counters") {
+        const std::string fens[] = {
+            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+            "rnbqkbnr/pp1ppppp/8/2p5/4P3/8/PPPP1PPP/RNBQKBNR w KQkq c6 0 2",
+            "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 b - - 17 42",
+            "4k3/8/8/8/8/8/8/4K2R w K - 3 60",
+        };
+        for (const auto& fen : fens) {
+            auto board = Board::fromFEN(fen);
+            REQUIRE(board != nullptr);
+            REQUIRE(board->toFEN() == fen);
+            REQUIRE(board->hash() == board->computeHash());
+        }
+    }
+
+    SECTION("Move counters are optional") {
+        auto board = Board::fromFEN("4k3/8/8/8/8/8/8/4K3 b - -");
+        REQUIRE(board != nullptr);
+        REQUIRE(board->getHalfmoveClock() == 0);
+        REQUIRE(board->getFullmoveNumber() == 1);
+        REQUIRE(board->getSideToMove() == Color::BLACK);
+    }
+
+    SECTION("Malformed FEN is rejected and leaves the board untouched") {
+        const char* bad[] = {
+            "",
+            "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP w KQkq - 0 1",
+            "rnbqkbnr/pppppppp/9/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+            "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNX w KQkq - 0 1",
+            "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq - 0 1",
+            "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkz - 0 1",
+            "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq e4 0 1",
+            "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - x 1",
+        };
+        for (const char* fen : bad) {
+            REQUIRE(Board::fromFEN(fen) == nullptr);
+        }
+        auto board = StandardBoard();
+        REQUIRE_FALSE(board->setFromFEN(bad[1]));
+        REQUIRE(board->toFEN() == START_FEN);
+    }
+
+    SECTION("Positions no game can reach are rejected") {
+        const char* illegal[] = {
+            "P7/8/8/8/8/8/8/k6K w - - 0 1",
+            "k7/8/8/8/8/8/8/7p b - - 0 1",
+            "8/8/8/8/8/8/8/8 w - -",
+            "4k3/8/8/8/8/8/8/8 w - - 0 1",
+            "4k3/8/8/8/8/8/8/3KK3 w - - 0 1",
+            "3kk3/8/8/8/8/8/8/4K3 b - - 0 1",
+        };
+        auto board = StandardBoard();
+        for (const char* fen : illegal) {
+            REQUIRE(Board::fromFEN(fen) == nullptr);
+            REQUIRE_FALSE(board->setFromFEN(fen));
+        }
+        REQUIRE(board->toFEN() == START_FEN);
+    }
+
+    SECTION("Making moves updates the counters") {
+        auto board = Board::fromFEN(START_FEN);
+        REQUIRE(board->makeMove({Square::G1, Square::F3}));
+        REQUIRE(board->toFEN() == "rnbqkbnr/pppppppp/8/8/8/5N2/PPPPPPPP/RNBQKB1R b KQkq - 1 1");
+        UndoInfo undo;
+        REQUIRE(board->doMove({Square::E7, Square::E5}, undo));
+        REQUIRE(board->toFEN() == "rnbqkbnr/pppp1ppp/8/4p3/8/5N2/PPPPPPPP/RNBQKB1R w KQkq e6 0 2");
+        board->undoMove(undo);
+        REQUIRE(board->toFEN() == "rnbqkbnr/pppppppp/8/8/8/5N2/PPPPPPPP/RNBQKB1R b KQkq - 1 1");
+    }
+}
+
+TEST_CASE("Board::see", "[see]") {
+    SECTION("Undefended pawn wins a pawn") {
+        auto board = Board::fromFEN("4k3/8/8/4p3/8/8/8/4RK2 w - - 0 1");
+        REQUIRE(board->see({Square::E1, Square::E5}) == 100);
+    }
+
+    SECTION("Knight takes a pawn defended by a pawn") {
+        auto board = Board::fromFEN("4k3/8/3p4/4p3/8/5N2/8/4K3 w - - 0 1");
+        REQUIRE(board->see({Square::F3, Square::E5}) == -220);
+        REQUIRE(board->seeGE({Square::F3, Square::E5}, -220));
+        REQUIRE_FALSE(board->seeGE({Square::F3, Square::E5}, -219));
+        REQUIRE_FALSE(board->seeGE({Square::F3, Square::E5}, 0));
+    }
+
+    SECTION("A rook behind the capturer joins the exchange") {
+        auto board = Board::fromFEN("k3r3/8/8/4p3/8/8/4R3/4RK2 w - - 0 1");
+        REQUIRE(board->see({Square::E2, Square::E5}) == 100);
+        REQUIRE(board->seeGE({Square::E2, Square::E5}, 100));
+        REQUIRE_FALSE(board->seeGE({Square::E2, Square::E5}, 101));
+    }
+
+    SECTION("The king only recaptures when nothing can take it back") {
+        auto defended = Board::fromFEN("8/8/3k4/4p3/8/8/4R3/K3R3 w - - 0 1");
+        REQUIRE(defended->see({Square::E2, Square::E5}) == 100);
+        REQUIRE(defended->seeGE({Square::E2, Square::E5}, 100));
+        auto alone = Board::fromFEN("8/8/3k4/4p3/8/8/8/K3R3 w - - 0 1");
+        REQUIRE(alone->see({Square::E1, Square::E5}) == -400);
+        REQUIRE_FALSE(alone->seeGE({Square::E1, Square::E5}, 0));
+    }
+
+    SECTION("En passant and promotion") {
+        auto enPassant = Board::fromFEN("4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1");
+        REQUIRE(enPassant->see({Square::E5, Square::D6}) == 100);
+        auto promotion = Board::fromFEN("4k3/P7/8/8/8/8/8/4K3 w - - 0 1");
+        REQUIRE(promotion->see({Square::A7, Square::A8}) == 800);
+        REQUIRE(promotion->seeGE({Square::A7, Square::A8}, 800));
+    }
+
+    SECTION("seeGE agrees with see on every capture") {
+        auto board = Board::fromFEN("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+        MoveList captures;
+        board->generateCaptures(captures);
+        REQUIRE_FALSE(captures.empty());
+        for (PackedMove move : captures) {
+            int value = board->see(move);
+            REQUIRE(board->seeGE(move, value));
+            REQUIRE_FALSE(board->seeGE(move, value + 1));
+        }
+    }
+}
+
+TEST_CASE("Draw detection", "[draw]") {
+    SECTION("Knight shuffles repeat the start position") {
+        auto board = StandardBoard();
+        const Move shuffle[] = {
+            {Square::G1, Square::F3}, {Square::G8, Square::F6},
+            {Square::F3, Square::G1}, {Square::F6, Square::G8},
+        };
+        REQUIRE_FALSE(board->isRepetition());
+        for (const Move& move : shuffle) REQUIRE(board->makeMove(move));
+        REQUIRE(board->isRepetition());
+        REQUIRE_FALSE(board->isThreefoldRepetition());
+        for (const Move& move : shuffle) REQUIRE(board->makeMove(move));
+        REQUIRE(board->isThreefoldRepetition());
+
+        UndoInfo undo;
+        REQUIRE(board->doMove({Square::E2, Square::E4}, undo));
+        REQUIRE_FALSE(board->isRepetition());
+        board->undoMove(undo);
+        REQUIRE(board->isThreefoldRepetition());
+    }
+
+    SECTION("Repetitions are still found once the key history wraps around") {
+        auto board = StandardBoard();
+        const Move shuffle[] = {
+            {Square::G1, Square::F3}, {Square::G8, Square::F6},
+            {Square::F3, Square::G1}, {Square::F6, Square::G8},
+        };
+        // Well past the capacity of the history; pawn moves then reset the clock.
+        for (int i = 0; i < 300; ++i) {
+            for (const Move& move : shuffle) REQUIRE(board->makeMove(move));
+        }
+        REQUIRE(board->makeMove({Square::E2, Square::E4}));
+        REQUIRE(board->makeMove({Square::E7, Square::E5}));
+        // The en passant square makes the position after e5 unique.
+        for (const Move& move : shuffle) REQUIRE(board->makeMove(move));
+        REQUIRE_FALSE(board->isRepetition());
+        for (const Move& move : shuffle) REQUIRE(board->makeMove(move));
+        REQUIRE(board->isRepetition());
+        REQUIRE_FALSE(board->isThreefoldRepetition());
+        for (const Move& move : shuffle) REQUIRE(board->makeMove(move));
+        REQUIRE(board->isThreefoldRepetition());
+    }
+
+    SECTION("Loading a FEN drops the earlier history") {
+        auto board = StandardBoard();
+        REQUIRE(board->makeMove({Square::G1, Square::F3}));
+        REQUIRE(board->makeMove({Square::G8, Square::F6}));
+        REQUIRE(board->makeMove({Square::F3, Square::G1}));
+        REQUIRE(board->makeMove({Square::F6, Square::G8}));
+        REQUIRE(board->isRepetition());
+        // The same position again, but with a clock that would reach back.
+        REQUIRE(board->setFromFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 4 3"));
+        REQUIRE_FALSE(board->isRepetition());
+        REQUIRE(board->hash() == board->computeHash());
+    }
+
+    SECTION("A pawn move cuts off the history") {
+        auto board = StandardBoard();
+        REQUIRE(board->makeMove({Square::G1, Square::F3}));
+        REQUIRE(board->makeMove({Square::G8, Square::F6}));
+        REQUIRE(board->makeMove({Square::F3, Square::G1}));
+        REQUIRE(board->makeMove({Square::F6, Square::G8}));
+        REQUIRE(board->isRepetition());
+        // Once the clock is back to zero earlier keys are no longer scanned.
+        board->setHalfmoveClock(0);
+        REQUIRE_FALSE(board->isRepetition());
+    }
+
+    SECTION("Fifty-move rule") {
+        auto board = Board::fromFEN("7k/8/8/8/8/8/8/R6K w - - 99 80");
+        REQUIRE_FALSE(board->isFiftyMoveDraw());
+        REQUIRE(board->makeMove({Square::A1, Square::B1}));
+        REQUIRE(board->isFiftyMoveDraw());
+    }
+
+    SECTION("Checkmate on the hundredth ply is not a draw") {
+        auto board = Board::fromFEN("7k/8/6K1/8/8/8/8/R7 w - - 99 80");
+        REQUIRE(board->makeMove({Square::A1, Square::A8}));
+        REQUIRE(board->getHalfmoveClock() == 100);
+        REQUIRE_FALSE(board->isFiftyMoveDraw());
+    }
+}
+
+TEST_CASE("readEPD", "[epd]") {
+    std::istringstream input(
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - ;D1 20 ;D2 400\n"
+        "\n"
+        "# a comment\n"
+        "not a position at all\n"
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1 ;D1 48\r\n"
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - bm Rxb4; id \"pos3\";");
+
+    std::vector<std::string> fens, operations;
+    std::vector<size_t> moveCounts;
+    size_t count = readEPD(input, [&](Board& board, std::string_view ops) {
+        fens.push_back(board.toFEN());
+        operations.emplace_back(ops);
+        MoveList moves;
+        board.generateLegalMoves(moves);
+        moveCounts.push_back(moves.size());
+    });
+
+    REQUIRE(count == 3);
+    REQUIRE(fens[0] == "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    REQUIRE(operations[0] == ";D1 20 ;D2 400");
+    REQUIRE(moveCounts[0] == 20);
+    REQUIRE(operations[1] == ";D1 48");
+    REQUIRE(moveCounts[1] == 48);
+    REQUIRE(operations[2] == "bm Rxb4; id \"pos3\";");
+    REQUIRE(moveCounts[2] == 14);
+}
+
+TEST_CASE("readEPD handles lines split across buffer reads", "[epd]") {
+    // Enough lines that several fall across the reader's buffer boundary.
+    std::string text;
+    const int LINES = 5000;
+    for (int i = 0; i < LINES; ++i) {
+        text += "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1 ;id \"";
+        text += std::to_string(i);
+        text += "\";\n";
+    }
+    std::istringstream input(text);
+    int expected = 0;
+    bool inOrder = true;
+    size_t count = readEPD(input, [&](Board& board, std::string_view ops) {
+        std::string id = ";id \"" + std::to_string(expected++) + "\";";
+        inOrder = inOrder && ops == id && board.getWhiteCastleKingside();
+    });
+    REQUIRE(count == LINES);
+    REQUIRE(inOrder);
+}
@@ -1,6 +1,10 @@
 #define CATCH_CONFIG_MAIN
 #include "catch2/catch_test_macros.hpp"
 #include "player.h"
+#include "move_picker.h"
+#include "transposition_table.h"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <memory>
 
@@ -72,4 +76,282 @@ TEST_CASE("MinMaxPlayer::makeMove", "[makeMove]") {
         std::cout << board->toString() << std::endl;
         REQUIRE(((board->getWhiteKnights() & static_cast<uint64_t>(Square::D5)) == 0));
     }
-}
\ No newline at end of file
+
+    SECTION("A depth 1 player sees the recapture after its capture") {
+        // Qxd5 wins a pawn at the horizon but loses the queen to exd5.
+        auto board = BoardBuilder(
+            "....k..."
+            "........"
+            "....p..."
+            "...p...."
+            "...Q...."
+            "........"
+            "........"
+            "....K...", Color::WHITE).Build();
+
+        MinMaxPlayer player(1);
+        REQUIRE(player.makeMove(*board));
+        REQUIRE(board->getNumBlackPawns() == 2);
+        REQUIRE(board->getNumWhiteQueens() == 1);
+    }
+
+    SECTION("Both colors find a back-rank mate") {
+        auto white = Board::fromFEN("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1");
+        MinMaxPlayer whitePlayer(4);
+        REQUIRE(whitePlayer.makeMove(*white));
+        REQUIRE(white->isKingInCheckmate(Color::BLACK));
+
+        auto black = Board::fromFEN("r5k1/8/8/8/8/8/5PPP/6K1 b - - 0 1");
+        MinMaxPlayer blackPlayer(4);
+        REQUIRE(blackPlayer.makeMove(*black));
+        REQUIRE(black->isKingInCheckmate(Color::WHITE));
+    }
+
+    SECTION("A timed player deepens until its budget and then stops") {
+        auto board = BoardBuilder(
+            "....k..."
+            "........"
+            "........"
+            "........"
+            "........"
+            ".R......"
+            "........"
+            ".q....K.", Color::WHITE).Build();
+
+        // The depth ceiling is far out of reach, so only the clock ends the search.
+        MinMaxPlayer player(64);
+        player.setTimeControl(std::chrono::seconds(2), std::chrono::milliseconds(0));
+        auto start = std::chrono::steady_clock::now();
+        REQUIRE(player.makeMove(*board));
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        REQUIRE(board->getNumBlackQueens() == 0);
+        // The limits themselves are checked below; this only catches a
+        // search that ignores them, so a loaded machine cannot fail it.
+        REQUIRE(elapsed < std::chrono::seconds(2));
+    }
+
+    SECTION("The time budget takes a share of the clock and most of the increment") {
+        using std::chrono::milliseconds;
+        auto budget = MinMaxPlayer::timeBudget(milliseconds(2000), milliseconds(0));
+        REQUIRE(budget.soft == milliseconds(50));
+        REQUIRE(budget.hard == milliseconds(200));
+
+        budget = MinMaxPlayer::timeBudget(milliseconds(60000), milliseconds(1000));
+        REQUIRE(budget.soft == milliseconds(2250));
+        REQUIRE(budget.hard == milliseconds(9000));
+
+        // A big increment cannot push a move past a fifth of the clock.
+        budget = MinMaxPlayer::timeBudget(milliseconds(1000), milliseconds(5000));
+        REQUIRE(budget.soft == milliseconds(200));
+        REQUIRE(budget.hard == milliseconds(200));
+
+        budget = MinMaxPlayer::timeBudget(milliseconds(0), milliseconds(0));
+        REQUIRE(budget.soft == milliseconds(0));
+        REQUIRE(budget.hard == milliseconds(0));
+    }
+
+    SECTION("A player with almost no time left still moves") {
+        auto board = StandardBoard();
+        MinMaxPlayer player(64);
+        player.setTimeControl(std::chrono::milliseconds(1), std::chrono::milliseconds(0));
+        REQUIRE(player.makeMove(*board));
+        REQUIRE(board->getSideToMove() == Color::BLACK);
+    }
+}
+// Drains the picker, checking it yields exactly the legal moves, each once.
+static std::vector<PackedMove> pickAll(Board& board, MovePicker& picker) {
+    std::vector<PackedMove> picked;
+    for (PackedMove move = picker.next(); move != PackedMove(); move = picker.next()) {
+        picked.push_back(move);
+    }
+
+    MoveList legal;
+    board.generateLegalMoves(legal);
+    std::vector<uint16_t> expected, actual;
+    for (PackedMove move : legal) expected.push_back(move.raw());
+    for (PackedMove move : picked) actual.push_back(move.raw());
+    std::sort(expected.begin(), expected.end());
+    std::sort(actual.begin(), actual.end());
+    REQUIRE(actual == expected);
+    return picked;
+}
+
+TEST_CASE("MovePicker", "[movePicker]") {
+    // Kiwipete: captures, castling and quiet moves all at once.
+    auto board = BoardBuilder(
+        "r...k..r"
+        "p.ppqpb."
+        "bn..pnp."
+        "...PN..."
+        ".p..P..."
+        "..N..Q.p"
+        "PPPBBPPP"
+        "R...K..R", Color::WHITE)
+        .setWhiteCastleKingside(true)
+        .setWhiteCastleQueenside(true)
+        .setBlackCastleKingside(true)
+        .setBlackCastleQueenside(true)
+        .Build();
+
+    SECTION("yields every legal move once with captures before quiet moves") {
+        MovePicker picker(*board);
+        std::vector<PackedMove> picked = pickAll(*board, picker);
+        // The first quiet move may only be followed by quiet moves and bad captures.
+        auto firstQuiet = std::find_if(picked.begin(), picked.end(),
+            [&](PackedMove move) { return !board->isCaptureMove(move); });
+        REQUIRE(firstQuiet != picked.begin());
+        REQUIRE(board->isCaptureMove(picked.front()));
+        // Qf3xf6 wins a knight and must come before the queen takes a pawn.
+        auto knightCapture = std::find(picked.begin(), picked.end(), PackedMove(21, 45));
+        auto pawnCapture = std::find(picked.begin(), picked.end(), PackedMove(21, 47));
+        REQUIRE(knightCapture < pawnCapture);
+    }
+
+    SECTION("hash move and killers come first and are not repeated") {
+        PackedMove hashMove(4, 6, PackedMove::CASTLING);
+        PackedMove killer(8, 24);
+        MovePicker picker(*board, hashMove, killer);
+        std::vector<PackedMove> picked = pickAll(*board, picker);
+        REQUIRE(picked.front() == hashMove);
+        auto killerPos = std::find(picked.begin(), picked.end(), killer);
+        auto firstQuiet = std::find_if(picked.begin() + 1, picked.end(),
+            [&](PackedMove move) { return !board->isCaptureMove(move); });
+        REQUIRE(killerPos == firstQuiet);
+    }
+
+    SECTION("illegal hash move and killers are dropped") {
+        // A stale promotion flag, a move of the wrong side and an empty slot.
+        MovePicker picker(*board, PackedMove(8, 16, PackedMove::PROMOTION), PackedMove(48, 40));
+        pickAll(*board, picker);
+    }
+
+    SECTION("captures that lose material come after the quiet moves") {
+        // Qe1xe5 is recaptured by the pawn on d6.
+        auto position = Board::fromFEN("4k3/8/3p4/4p3/8/8/8/4QK2 w - - 0 1");
+        MovePicker picker(*position);
+        std::vector<PackedMove> picked = pickAll(*position, picker);
+        REQUIRE(picked.back() == PackedMove(4, 36));
+    }
+
+    SECTION("quiet moves come in history order") {
+        ButterflyHistory history = {};
+        history[static_cast<int>(Color::WHITE)][8][16] = 100;   // a2a3
+        history[static_cast<int>(Color::WHITE)][14][22] = 50;   // g2g3
+        history[static_cast<int>(Color::BLACK)][48][40] = 200;  // a7a6, not White's move
+        MovePicker picker(*board, PackedMove(), PackedMove(), PackedMove(), &history);
+        std::vector<PackedMove> picked = pickAll(*board, picker);
+        auto firstQuiet = std::find_if(picked.begin(), picked.end(),
+            [&](PackedMove move) { return !board->isCaptureMove(move); });
+        REQUIRE(firstQuiet[0] == PackedMove(8, 16));
+        REQUIRE(firstQuiet[1] == PackedMove(14, 22));
+    }
+
+    SECTION("the captures-only picker skips quiet moves and losing captures") {
+        // Of Kiwipete's eight captures only Bxa6, gxh3 and dxe6 keep material.
+        MovePicker picker(*board, MovePicker::CapturesOnly{});
+        std::vector<PackedMove> picked;
+        for (PackedMove move = picker.next(); move != PackedMove(); move = picker.next()) {
+            REQUIRE(board->isCaptureMove(move));
+            picked.push_back(move);
+        }
+        std::vector<PackedMove> expected = {PackedMove(12, 40), PackedMove(14, 23), PackedMove(35, 44)};
+        REQUIRE(picked == expected);
+    }
+
+    SECTION("no moves when mated") {
+        auto mated = BoardBuilder(
+            "R......k"
+            "......pp"
+            "........"
+            "........"
+            "........"
+            "........"
+            "........"
+            "K.......", Color::BLACK).Build();
+        MovePicker picker(*mated);
+        REQUIRE(picker.next() == PackedMove());
+    }
+}
+
+TEST_CASE("TranspositionTable", "[transpositionTable]") {
+    TranspositionTable table(1);
+    PackedMove move(12, 28);
+
+    SECTION("stores and probes an entry") {
+        TTEntry entry;
+        REQUIRE_FALSE(table.probe(42, entry));
+        table.store(42, 5, Bound::LOWER, -1234, move);
+        REQUIRE(table.probe(42, entry));
+        REQUIRE(entry.depth == 5);
+        REQUIRE(entry.bound() == Bound::LOWER);
+        REQUIRE(entry.score == -1234);
+        REQUIRE(entry.move == move);
+    }
+
+    SECTION("a new result for the same key keeps the old move if it has none") {
+        table.store(42, 3, Bound::EXACT, 10, move);
+        table.store(42, 4, Bound::UPPER, 20, PackedMove());
+        TTEntry entry;
+        REQUIRE(table.probe(42, entry));
+        REQUIRE(entry.depth == 4);
+        REQUIRE(entry.move == move);
+    }
+
+    SECTION("a shallower bound for the same key only refreshes the move and age") {
+        PackedMove other(11, 27);
+        table.store(42, 6, Bound::LOWER, 30, move);
+        table.newSearch();
+        table.store(42, 2, Bound::UPPER, -50, other);
+        TTEntry entry;
+        REQUIRE(table.probe(42, entry));
+        REQUIRE(entry.depth == 6);
+        REQUIRE(entry.bound() == Bound::LOWER);
+        REQUIRE(entry.score == 30);
+        REQUIRE(entry.move == other);
+        REQUIRE(entry.age() == 1);
+
+        // An exact score is always worth keeping, however shallow.
+        table.store(42, 1, Bound::EXACT, 7, PackedMove());
+        REQUIRE(table.probe(42, entry));
+        REQUIRE(entry.depth == 1);
+        REQUIRE(entry.bound() == Bound::EXACT);
+        REQUIRE(entry.move == other);
+    }
+
+    // Keys that differ only in their high bits share a bucket.
+    auto colliding = [](uint64_t i) { return 7 + (i << 40); };
+
+    SECTION("a full bucket gives up its shallowest entry") {
+        for (int i = 0; i < 4; ++i) table.store(colliding(i), 2 + i, Bound::EXACT, i, move);
+        table.store(colliding(4), 9, Bound::EXACT, 4, move);
+        TTEntry entry;
+        REQUIRE_FALSE(table.probe(colliding(0), entry));
+        for (int i = 1; i <= 4; ++i) REQUIRE(table.probe(colliding(i), entry));
+    }
+
+    SECTION("entries from earlier searches are replaced first") {
+        // Three searches old, the deeper entry is worth less than a fresh one.
+        table.store(colliding(0), 8, Bound::EXACT, 0, move);
+        for (int i = 0; i < 3; ++i) table.newSearch();
+        for (int i = 1; i < 4; ++i) table.store(colliding(i), 4, Bound::EXACT, i, move);
+        table.store(colliding(4), 4, Bound::EXACT, 4, move);
+        TTEntry entry;
+        REQUIRE_FALSE(table.probe(colliding(0), entry));
+        REQUIRE(table.probe(colliding(4), entry));
+    }
+
+    SECTION("MinMaxPlayer finds the same move with a table") {
+        auto board = BoardBuilder(
+            "rnbqk.nr"
+            "p.pp.ppp"
+            ".p..p..."
+            "...N...."
+            ".b..P..."
+            ".....N.."
+            "PPPP.PPP"
+            "R.BQKB.R", Color::BLACK).Build();
+        MinMaxPlayer player(4, 1);
+        REQUIRE(player.makeMove(*board));
+        REQUIRE(board->getNumWhiteKnights() == 1);
+    }
+}
@@ -0,0 +1,72 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_test_macros.hpp"
+#include "perft.h"
+
+TEST_CASE("perft", "[perft]") {
+    SECTION("Matches the reference counts at shallow depth") {
+        // Depth 3 counts for the standard positions.
+        const uint64_t expected[6] = { 8902, 97862, 2812, 9467, 62379, 89890 };
+        for (int i = 0; i < 6; ++i) {
+            auto board = Board::fromFEN(STANDARD_PERFT_POSITIONS[i].fen);
+            REQUIRE(board != nullptr);
+            REQUIRE(perft(*board, 3) == expected[i]);
+        }
+    }
+
+    SECTION("Depth 0 is the position itself and depth 1 the legal moves") {
+        auto board = StandardBoard();
+        REQUIRE(perft(*board, 0) == 1);
+        REQUIRE(perft(*board, 1) == 20);
+    }
+
+    SECTION("Divide sums to the total and leaves the board unchanged") {
+        auto board = Board::fromFEN(STANDARD_PERFT_POSITIONS[1].fen);
+        std::string before = board->toFEN();
+        auto divide = perftDivide(*board, 3);
+        REQUIRE(divide.size() == 48);
+        uint64_t total = 0;
+        for (const auto& entry : divide) total += entry.nodes;
+        REQUIRE(total == 97862);
+        REQUIRE(board->toFEN() == before);
+    }
+
+    SECTION("The hash table gives the same counts") {
+        PerftTable table(1);
+        for (const auto& position : STANDARD_PERFT_POSITIONS) {
+            auto board = Board::fromFEN(position.fen);
+            uint64_t plain = perft(*board, 4);
+            REQUIRE(perft(*board, 4, &table) == plain);
+            // A second run is answered from the table.
+            REQUIRE(perft(*board, 4, &table) == plain);
+        }
+    }
+}
+
+TEST_CASE("perftParallel", "[perft]") {
+    SECTION("Matches single-threaded perft") {
+        for (const auto& position : STANDARD_PERFT_POSITIONS) {
+            auto board = Board::fromFEN(position.fen);
+            REQUIRE(perftParallel(*board, 4, 4) == perft(*board, 4));
+        }
+    }
+
+    SECTION("Divide matches move by move and leaves the board unchanged") {
+        auto board = Board::fromFEN(STANDARD_PERFT_POSITIONS[3].fen);
+        std::string before = board->toFEN();
+        auto serial = perftDivide(*board, 4);
+        auto parallel = perftDivideParallel(*board, 4, 3);
+        REQUIRE(parallel.size() == serial.size());
+        for (size_t i = 0; i < serial.size(); ++i) {
+            REQUIRE(parallel[i].move == serial[i].move);
+            REQUIRE(parallel[i].nodes == serial[i].nodes);
+        }
+        REQUIRE(board->toFEN() == before);
+    }
+
+    SECTION("A shared hash table gives the same counts") {
+        PerftTable table(1);
+        auto board = StandardBoard();
+        REQUIRE(perftParallel(*board, 5, 4, &table) == 4865609);
+        REQUIRE(perftParallel(*board, 5, 4, &table) == 4865609);
+    }
+}
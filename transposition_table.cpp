@@ -0,0 +1,59 @@
+#include "transposition_table.h"
+#include <algorithm>
+#include <bit>
+
+TranspositionTable::TranspositionTable(size_t megabytes) {
+    // Round down to a power of two number of buckets, keeping at least one.
+    size_t count = std::max<size_t>(1, megabytes * 1024 * 1024 / sizeof(Bucket));
+    count = std::bit_floor(count);
+    buckets.assign(count, Bucket{});
+    mask = count - 1;
+}
+
+bool TranspositionTable::probe(uint64_t key, TTEntry& entry) const {
+    for (const TTEntry& candidate : buckets[key & mask].entries) {
+        if (candidate.key == key && candidate.bound() != Bound::NONE) {
+            entry = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+int TranspositionTable::relativeAge(const TTEntry& entry) const {
+    return (generation - entry.age()) & 0x3F;
+}
+
+void TranspositionTable::store(uint64_t key, int depth, Bound bound, int score, PackedMove move) {
+    TTEntry* entries = buckets[key & mask].entries;
+    TTEntry* replace = &entries[0];
+    for (int i = 0; i < BUCKET_SIZE; ++i) {
+        if (entries[i].key == key) {
+            replace = &entries[i];
+            if (move == PackedMove()) move = replace->move;
+            // A shallower bound tells less than the result already here, so
+            // only its move and the entry's age are taken.
+            if (depth < replace->depth && bound != Bound::EXACT) {
+                replace->move = move;
+                replace->boundAndAge = static_cast<uint8_t>((generation << 2) | (replace->boundAndAge & 3));
+                return;
+            }
+            break;
+        }
+        // Each generation of age counts as four plies of depth.
+        if (entries[i].depth - 4 * relativeAge(entries[i]) < replace->depth - 4 * relativeAge(*replace)) {
+            replace = &entries[i];
+        }
+    }
+    *replace = TTEntry{key, score, move, static_cast<int8_t>(depth),
+                       static_cast<uint8_t>((generation << 2) | static_cast<uint8_t>(bound))};
+}
+
+void TranspositionTable::newSearch() {
+    generation = (generation + 1) & 0x3F;
+}
+
+void TranspositionTable::clear() {
+    std::fill(buckets.begin(), buckets.end(), Bucket{});
+    generation = 0;
+}
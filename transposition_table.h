@@ -0,0 +1,63 @@
+#ifndef TRANSPOSITION_TABLE_H
+#define TRANSPOSITION_TABLE_H
+
+#include "board.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// How a stored score relates to the true value of the position: exact, or
+// only a lower bound (the search failed high) or an upper bound (failed low).
+enum class Bound : uint8_t { NONE, EXACT, LOWER, UPPER };
+
+struct TTEntry {
+    uint64_t key;
+    int32_t score;
+    PackedMove move;
+    int8_t depth;
+    // Low two bits hold the Bound, the rest the search generation.
+    uint8_t boundAndAge;
+
+    Bound bound() const { return static_cast<Bound>(boundAndAge & 3); }
+    uint8_t age() const { return boundAndAge >> 2; }
+};
+
+static_assert(sizeof(TTEntry) == 16, "TTEntry must stay 16 bytes");
+
+// Fixed-size table of search results keyed by Zobrist key. Entries live in
+// buckets of four that fill exactly one cache line, so a probe touches a
+// single line. A power-of-two bucket count lets the key be masked into an
+// index.
+class TranspositionTable {
+public:
+    explicit TranspositionTable(size_t megabytes);
+
+    // Copies the entry for the key into entry; false if there is none.
+    bool probe(uint64_t key, TTEntry& entry) const;
+    // Stores a result. A key already in the bucket is overwritten, keeping
+    // its move if none is given, unless the new result is a shallower bound:
+    // then only the move and age are refreshed. Otherwise the shallowest
+    // entry is replaced, with entries from earlier searches counting as
+    // shallower.
+    void store(uint64_t key, int depth, Bound bound, int score, PackedMove move);
+
+    // Starts a new search, so entries left by earlier ones age.
+    void newSearch();
+    void clear();
+
+private:
+    static constexpr int BUCKET_SIZE = 4;
+
+    struct alignas(64) Bucket {
+        TTEntry entries[BUCKET_SIZE];
+    };
+
+    std::vector<Bucket> buckets;
+    size_t mask;
+    uint8_t generation = 0;
+
+    // Generations since the entry was written, wrapping at 64.
+    int relativeAge(const TTEntry& entry) const;
+};
+
+#endif // TRANSPOSITION_TABLE_H